@@ -0,0 +1,112 @@
+#ifndef ACTIVITY_MAP_H
+#define ACTIVITY_MAP_H
+
+#include <algorithm> // Includes the algorithm library for max.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <vector> // Includes the vector library for the tiles.
+#include "world.h" // Includes the world.h header file.
+#include "simulation.h" // Includes the simulation.h header file.
+
+// What the heatmap shows for every chunk, if anything.
+enum class HeatmapMode {
+    Off,
+    Updates, // The number of particles updated per tick.
+    Moves, // The number of particles that moved or changed per tick.
+    Time // The time spent updating the chunk per tick.
+};
+
+// The next mode, in the order they are cycled through.
+inline HeatmapMode nextHeatmapMode(const HeatmapMode mode) {
+    return mode == HeatmapMode::Time ? HeatmapMode::Off : static_cast<HeatmapMode>(static_cast<int>(mode) + 1);
+}
+
+// An image of the world with one pixel per chunk, colored by how active the chunk is, drawn on top of the world.
+// Built by the simulation thread and handed to the main thread with the rest of the snapshot.
+struct Heatmap {
+    int width; // The size of the image, in chunks.
+    int height;
+    std::vector<uint32_t> pixels; // The colors of the chunks, row by row, with the activity in the alpha channel.
+    HeatmapMode mode = HeatmapMode::Off; // What the image shows. Off means it wasn't built, and shouldn't be drawn.
+    double peak = 0.0; // The value of the most active chunk, which is drawn in the hottest color.
+
+    Heatmap(const int worldWidth, const int worldHeight)
+        : width((worldWidth + CHUNK_SIZE - 1) / CHUNK_SIZE), height((worldHeight + CHUNK_SIZE - 1) / CHUNK_SIZE),
+          pixels(static_cast<size_t>(width) * height, 0) {}
+
+    // The number of bytes between the start of two rows.
+    int pitch() const {
+        return width * static_cast<int>(sizeof(uint32_t));
+    }
+
+    // The unit of the values, for the window title.
+    const char* unit() const {
+        switch (mode) {
+            case HeatmapMode::Updates: return "updates/tick";
+            case HeatmapMode::Moves: return "moves/tick";
+            case HeatmapMode::Time: return "us/tick";
+            default: return nullptr;
+        }
+    }
+};
+
+// Keeps a decaying average of what happened in every chunk, so that the heatmap shows where the work is over the last few ticks
+// instead of flickering with every tick. The tiles are the chunks, as those are what the simulation schedules and times.
+class ActivityMap {
+public:
+    // How much of the average is kept from one tick to the next. At 60 ticks per second, a chunk that goes quiet fades out in about a second.
+    static constexpr float DECAY = 0.95f;
+
+    explicit ActivityMap(const size_t chunks) : averages(chunks) {}
+
+    // Adds the activity of the last tick to the averages.
+    void add(const std::vector<ChunkActivity>& activity) {
+        for (size_t i = 0; i < averages.size(); i++) {
+            Average& average = averages[i];
+            average.updates = average.updates * DECAY + static_cast<float>(activity[i].updates) * (1.0f - DECAY);
+            average.moves = average.moves * DECAY + static_cast<float>(activity[i].moves) * (1.0f - DECAY);
+            average.microseconds = average.microseconds * DECAY + activity[i].microseconds * (1.0f - DECAY);
+        }
+    }
+
+    // Forgets everything, like when the heatmap is turned back on after a while.
+    void reset() {
+        std::fill(averages.begin(), averages.end(), Average{});
+    }
+
+    // Colors every chunk of the heatmap by the averages of the given mode, relative to the most active chunk.
+    // Quiet chunks are transparent, and the more active a chunk is, the more opaque it is, going from green through yellow to red.
+    void build(const HeatmapMode mode, Heatmap& heatmap) const {
+        heatmap.mode = mode;
+        float peak = 0.0f;
+        for (const Average& average : averages) peak = std::max(peak, average.value(mode));
+        heatmap.peak = peak;
+
+        for (size_t i = 0; i < averages.size(); i++) {
+            const float t = peak > 0.0f ? averages[i].value(mode) / peak : 0.0f;
+            if (t < 1.0f / 256.0f) {
+                heatmap.pixels[i] = 0;
+                continue;
+            }
+            const uint32_t red = static_cast<uint32_t>(std::min(255.0f, 510.0f * t));
+            const uint32_t green = static_cast<uint32_t>(std::min(255.0f, 510.0f * (1.0f - t)));
+            const uint32_t alpha = static_cast<uint32_t>(64.0f + 128.0f * t);
+            heatmap.pixels[i] = alpha << 24 | red << 16 | green << 8;
+        }
+    }
+
+private:
+    // The averages of a single chunk.
+    struct Average {
+        float updates = 0.0f;
+        float moves = 0.0f;
+        float microseconds = 0.0f;
+
+        float value(const HeatmapMode mode) const {
+            return mode == HeatmapMode::Updates ? updates : mode == HeatmapMode::Moves ? moves : microseconds;
+        }
+    };
+
+    std::vector<Average> averages; // One for every chunk, row by row.
+};
+
+#endif //ACTIVITY_MAP_H
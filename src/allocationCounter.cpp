@@ -0,0 +1,19 @@
+#include <cstdlib> // Includes the cstdlib library for malloc and free.
+#include <new> // Includes the new library for std::bad_alloc.
+#include "stats.h" // Includes the stats.h header file.
+
+// Replaces the global operator new and delete, so that every heap allocation gets counted.
+// The array and nothrow versions forward to these in the standard library, so they get counted as well.
+void* operator new(const size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
@@ -0,0 +1,98 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <algorithm> // Includes the algorithm library for min and max.
+#include "world.h" // Includes the world.h header file.
+
+// The part of the world that is shown in the window. Looks at the world from a cell in the top left corner,
+// with every cell drawn as a square of zoom x zoom pixels. The zoom is a whole number, so the cells stay sharp squares.
+class Camera {
+public:
+    static constexpr int MIN_ZOOM = 1;
+    static constexpr int MAX_ZOOM = 32;
+    static constexpr int PAN_STEP = 64; // How far the arrow keys move the camera, in pixels.
+
+    int x = 0; // The cell in the top left corner of the window.
+    int y = 0;
+    int zoom; // The size of each cell on the screen, in pixels.
+
+    Camera(const int worldWidth, const int worldHeight, const int viewWidth, const int viewHeight, const int zoom)
+        : zoom(std::max(MIN_ZOOM, std::min(zoom, MAX_ZOOM))), worldWidth(worldWidth), worldHeight(worldHeight), viewWidth(viewWidth), viewHeight(viewHeight) {}
+
+    // The number of cells that fit in the window, including the ones that are only partly visible.
+    int visibleWidth() const {
+        return (viewWidth + zoom - 1) / zoom;
+    }
+
+    int visibleHeight() const {
+        return (viewHeight + zoom - 1) / zoom;
+    }
+
+    // The cells of the world that are visible in the window. The bounds are inclusive, like every dirty rectangle.
+    DirtyRect visibleCells() const {
+        return DirtyRect{x, y, std::min(x + visibleWidth(), worldWidth) - 1, std::min(y + visibleHeight(), worldHeight) - 1};
+    }
+
+    // Converts a position in the window, in pixels, to the cell under it.
+    void screenToWorld(const int screenX, const int screenY, int& cellX, int& cellY) const {
+        cellX = x + floorDivide(screenX, zoom);
+        cellY = y + floorDivide(screenY, zoom);
+    }
+
+    // Moves the camera by the given number of cells.
+    void pan(const int cellsX, const int cellsY) {
+        x += cellsX;
+        y += cellsY;
+        clamp();
+    }
+
+    // Moves the camera so that the given cell is in the middle of the window.
+    void centerOn(const int cellX, const int cellY) {
+        x = cellX - visibleWidth() / 2;
+        y = cellY - visibleHeight() / 2;
+        clamp();
+    }
+
+    // Changes the zoom, keeping the cell under the given position in the window in place.
+    void zoomAt(const int screenX, const int screenY, const int newZoom) {
+        int cellX, cellY;
+        screenToWorld(screenX, screenY, cellX, cellY);
+        zoom = std::max(MIN_ZOOM, std::min(newZoom, MAX_ZOOM));
+        x = cellX - screenX / zoom;
+        y = cellY - screenY / zoom;
+        clamp();
+    }
+
+    // Goes back to showing the top left corner of the world at the given zoom.
+    void reset(const int newZoom) {
+        zoom = std::max(MIN_ZOOM, std::min(newZoom, MAX_ZOOM));
+        x = 0;
+        y = 0;
+    }
+
+    bool operator==(const Camera& other) const {
+        return x == other.x && y == other.y && zoom == other.zoom;
+    }
+
+    bool operator!=(const Camera& other) const {
+        return !(*this == other);
+    }
+
+private:
+    int worldWidth; // The size of the world, in cells.
+    int worldHeight;
+    int viewWidth; // The size of the window, in pixels.
+    int viewHeight;
+
+    // Keeps the camera over the world. If the world is smaller than the window, it stays in the top left corner.
+    void clamp() {
+        x = std::max(0, std::min(x, worldWidth - viewWidth / zoom));
+        y = std::max(0, std::min(y, worldHeight - viewHeight / zoom));
+    }
+
+    static int floorDivide(const int a, const int b) {
+        return a >= 0 ? a / b : -((-a + b - 1) / b);
+    }
+};
+
+#endif //CAMERA_H
@@ -1,79 +1,73 @@
 #ifndef FIREPARTICLE_H
 #define FIREPARTICLE_H
 
-#include "globals.h"
+#include "world.h"
+#include "gunpowderParticle.h"
 
-// The fire particle class. Inherits from the particle class.
-class FireParticle : public Particle {
+// The rules for the fire particle. Operates on the cells of the world.
+class FireParticle {
 public:
-    FireParticle(const int x, const int y) {
-        id = 4;
-        position = {x, y};
-        velocity = {};
-        color = fireColor[rand() % 3];
+    static constexpr uint8_t id = 4;
+    static constexpr ParticleType type = ParticleType::Fire;
+    static constexpr char symbol = 'f'; // The character used for this particle in text scenes.
+    static constexpr int shades = 3; // The number of colors this particle can have.
+
+    static Cell create(Random& rng) {
+        return Cell{makeMaterial(id, rng.below(3)), {0, 0}, 0};
     }
 
-    // Checks if the given position is within the bounds of the world.
-    static bool inBounds(const int x, const int y) {
-        return x >= 0 && x < WIDTH / PARTICLE_SIZE && y >= 0 && y < HEIGHT / PARTICLE_SIZE;
+    static color_t color(const int shade) {
+        return fireColor[shade];
     }
 
-    void update() override {
+    // Updates the particle. Works on the world itself, as well as on any view of it with the same functions.
+    template <typename Grid>
+    static void update(Grid& world, int x, int y, Random& rng) {
         // Checks if the particle should be deleted. This is done randomly to prevent the fire from spreading too much.
-        if (rand() % 10 == 0) {
-            worldParticleData[this->position[1] * (WIDTH / PARTICLE_SIZE) + this->position[0]] = nullptr;
+        if (rng.below(10) == 0) {
+            world.clear(x, y);
+            return;
         }
-        else {
-            // Adds a small random velocity to the particle
-            this->velocity[0] += (static_cast<float>(rand() % 3 - 1)) * 0.5f; // Generates a pseudo-random value between -0.5 and 0.5.
-            this->velocity[1] += (static_cast<float>(rand() % 3 - 1)) * 0.5f;
 
-            // Calculates the new position based on the velocity.
-            int newX = this->position[0] + static_cast<int>(this->velocity[0]);
-            int newY = this->position[1] + static_cast<int>(this->velocity[1]);
+        Cell& cell = world.at(x, y);
+        world.markUpdated(cell); // Stamps the particle with the current frame, so that it is not updated again this frame.
+        world.markDirty(x, y); // Keeps the chunk awake while the fire burns, even if it doesn't move.
 
-            // Checks if the new position is within the bounds.
-            if (inBounds(newX, newY)) {
-                const Particle* otherParticle = worldParticleData[newY * (WIDTH / PARTICLE_SIZE) + newX];
-                if (otherParticle == nullptr) {
-                    // Moves the particle to the new position.
-                    worldParticleData[this->position[1] * (WIDTH / PARTICLE_SIZE) + this->position[0]] = nullptr;
-                    worldParticleData[newY * (WIDTH / PARTICLE_SIZE) + newX] = this;
-                    this->position[0] = newX;
-                    this->position[1] = newY;
-                } else if (otherParticle->id == 3) {
-                    // Converts the other particle to fire.
-                    delete otherParticle;
-                    worldParticleData[newY * (WIDTH / PARTICLE_SIZE) + newX] = new FireParticle(newX, newY);
-                }
-            } else {
-                // Resets the velocity if the new position is not valid.
-                this->velocity[0] = 0;
-                this->velocity[1] = 0;
-            }
+        // Adds a small random velocity to the particle
+        addVelocity(cell.velocity[0], (static_cast<int>(rng.below(3)) - 1) * VELOCITY_SCALE / 2); // Generates a pseudo-random value between -0.5 and 0.5.
+        addVelocity(cell.velocity[1], (static_cast<int>(rng.below(3)) - 1) * VELOCITY_SCALE / 2);
 
-            // Check if the next position will be a particle with an id of 3.
-            newX = this->position[0] + 2 * static_cast<int>(this->velocity[0]); // Interpolates two iterations into the future.
-            newY = this->position[1] + 2 * static_cast<int>(this->velocity[1]); // Interpolates two iterations into the future.
+        // Calculates the new position based on the velocity.
+        int newX = x + cell.velocity[0] / VELOCITY_SCALE;
+        int newY = y + cell.velocity[1] / VELOCITY_SCALE;
 
-            if (inBounds(newX, newY)) {
-                const Particle* otherParticle = worldParticleData[newY * (WIDTH / PARTICLE_SIZE) + newX];
-                if (otherParticle != nullptr && otherParticle->id == 3) {
-                    // Converts the other particle to fire.
-                    delete otherParticle;
-                    worldParticleData[newY * (WIDTH / PARTICLE_SIZE) + newX] = new FireParticle(newX, newY);
-                }
+        // Checks if the new position is within the bounds.
+        if (world.inBounds(newX, newY)) {
+            const Cell& otherCell = world.at(newX, newY);
+            if (otherCell.id() == 0) {
+                // Moves the particle to the new position.
+                world.move(x, y, newX, newY);
+                x = newX;
+                y = newY;
+            } else if (otherCell.id() == GunpowderParticle::id) {
+                // Converts the other particle to fire.
+                world.set(newX, newY, create(rng));
             }
+        } else {
+            // Resets the velocity if the new position is not valid.
+            cell.velocity[0] = 0;
+            cell.velocity[1] = 0;
         }
 
-        this->updatedThisFrame = true; // Sets the updatedThisFrame variable to true, so that the particle is not updated again this frame.
-    }
+        // Check if the next position will be a particle with the id of gunpowder.
+        const Cell& current = world.at(x, y);
+        newX = x + 2 * (current.velocity[0] / VELOCITY_SCALE); // Interpolates two iterations into the future.
+        newY = y + 2 * (current.velocity[1] / VELOCITY_SCALE); // Interpolates two iterations into the future.
 
-    void render(SDL_Renderer* renderer, const int x, const int y) override {
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-
-        const SDL_Rect rect = {x * PARTICLE_SIZE, y * PARTICLE_SIZE, PARTICLE_SIZE, PARTICLE_SIZE};
-        SDL_RenderFillRect(renderer, &rect);
+        if (world.inBounds(newX, newY) && world.at(newX, newY).id() == GunpowderParticle::id) {
+            // Converts the other particle to fire.
+            world.set(newX, newY, create(rng));
+        }
     }
 };
 
@@ -0,0 +1,223 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include <algorithm> // Includes the algorithm library for min and max.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <vector> // Includes the vector library for the pixels.
+#include "world.h" // Includes the world.h header file.
+#include "palette.h" // Includes the palette.h header file.
+#if defined(__AVX2__)
+#include <immintrin.h> // Includes the AVX2 intrinsics for looking up the colors of eight cells at once.
+#endif
+
+// An image of the world with one pixel per cell. Built on the CPU, and uploaded to the screen in one go.
+// Doesn't depend on SDL, so the headless simulation can use it as well.
+// The image is kept from one frame to the next, and only the cells that changed since the last frame are drawn and uploaded again.
+class FrameBuffer {
+public:
+    const int width; // The width of the image, in pixels.
+    const int height; // The height of the image, in pixels.
+    std::vector<uint32_t> pixels; // The pixels, row by row, from the top left corner.
+
+    std::vector<DirtyRect> regions; // The parts of the image that were drawn since it was last uploaded, and need to be uploaded.
+    uint64_t cellsRedrawn = 0; // The number of cells drawn since the image was last uploaded.
+    uint64_t bytesUploaded = 0; // The number of bytes in the regions.
+
+    FrameBuffer(const int width, const int height) : width(width), height(height), pixels(static_cast<size_t>(width) * height, EMPTY_PIXEL) {}
+
+    // The number of bytes between the start of two rows.
+    int pitch() const {
+        return width * static_cast<int>(sizeof(uint32_t));
+    }
+
+    // Draws every cell in the given rows of the world into the image.
+    void build(const World& world, const int beginY, const int endY) {
+        for (int y = beginY; y < endY; y++) {
+            buildRow(world, y, 0, world.width);
+        }
+    }
+
+    // Draws the whole world into the image.
+    void build(const World& world) {
+        build(world, 0, world.height);
+    }
+
+    // Makes the whole world count as changed, for when the image doesn't match the world anymore.
+    void invalidate() {
+        fullRedraw = true;
+    }
+
+    // Makes every chunk that touches the given area count as changed, so that all of them are drawn and uploaded again.
+    // Used when a part of the world comes into view, as the image may have skipped the changes made while it was out of view.
+    void invalidateArea(const DirtyRect& area) {
+        if (damage.empty() || area.empty()) return;
+        forEachChunkIn(area, [this](const size_t i, const DirtyRect& bounds) { damage[i] = bounds; });
+    }
+
+    // Remembers the cells that changed in the world so far. Has to be called before the simulation starts a new frame,
+    // as that forgets the cells changed by the brush, and again after the simulation is updated, for the cells it changed.
+    void collectChanges(const World& world) {
+        if (damage.size() != world.chunks.size()) {
+            damage.assign(world.chunks.size(), DirtyRect{});
+            unsent.assign(world.chunks.size(), DirtyRect{});
+            regions.reserve(world.chunks.size());
+            fullRedraw = true;
+        }
+
+        for (size_t i = 0; i < world.chunks.size(); i++) {
+            // Clips the changes to the world, as the cells next to a change can be past the edge of a chunk that is cut off.
+            const DirtyRect changed = world.chunks[i].nextDirty.load();
+            if (!changed.empty()) {
+                damage[i].include(std::max(changed.minX, 0), std::max(changed.minY, 0),
+                    std::min(changed.maxX, world.width - 1), std::min(changed.maxY, world.height - 1));
+            }
+        }
+    }
+
+    // Draws the cells that changed since the last call, and fills in the regions that need to be uploaded.
+    // The regions cover everything drawn since the image was last uploaded, so an image that is built several times
+    // before it is shown still uploads every change.
+    void buildChanged(const World& world) {
+        buildChanged(world, DirtyRect{0, 0, width - 1, height - 1});
+    }
+
+    // Draws the cells that changed since the last call in the chunks that touch the visible area. The changes in the other chunks
+    // are kept until they come into view, so that the cost of drawing depends on the size of the view, not the size of the world.
+    // When the palette changes, only the chunks in view that hold a recolored particle are drawn again. The chunks out of view
+    // are drawn again anyway when they come into view.
+    void buildChanged(const World& world, const DirtyRect& visible) {
+        if (damage.size() != world.chunks.size()) collectChanges(world);
+
+        if (fullRedraw) {
+            forEachChunkIn(DirtyRect{0, 0, width - 1, height - 1}, [this](const size_t i, const DirtyRect& bounds) { damage[i] = bounds; });
+            fullRedraw = false;
+        } else if (paletteVersion != palette.version) {
+            const uint64_t recolored = palette.idsChangedSince(paletteVersion);
+            forEachChunkIn(visible, [&](const size_t i, const DirtyRect& bounds) {
+                if (holdsAny(world, bounds, recolored)) damage[i] = bounds;
+            });
+        }
+        paletteVersion = palette.version;
+
+        forEachChunkIn(visible, [&](const size_t i, const DirtyRect&) {
+            DirtyRect& rect = damage[i];
+            if (rect.empty()) return;
+
+            for (int y = rect.minY; y <= rect.maxY; y++) {
+                buildRow(world, y, rect.minX, rect.maxX + 1);
+            }
+            cellsRedrawn += static_cast<uint64_t>(rect.maxX - rect.minX + 1) * (rect.maxY - rect.minY + 1);
+            unsent[i].include(rect.minX, rect.minY, rect.maxX, rect.maxY);
+            rect = DirtyRect{};
+        });
+
+        findRegions();
+    }
+
+    // Marks the image as uploaded, so that the next regions only cover what is drawn from now on.
+    void markUploaded() {
+        for (DirtyRect& rect : unsent) rect = DirtyRect{};
+        regions.clear();
+        cellsRedrawn = 0;
+        bytesUploaded = 0;
+    }
+
+private:
+    std::vector<DirtyRect> damage; // The cells of each chunk that changed since they were last drawn.
+    std::vector<DirtyRect> unsent; // The cells of each chunk that were drawn since the image was last uploaded.
+    bool fullRedraw = true; // Whether the whole image has to be drawn again, like on the first frame.
+    uint32_t paletteVersion = 0; // The version of the palette the image was drawn with.
+
+    int chunksX() const {
+        return (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+
+    int chunksY() const {
+        return (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    }
+
+    // Calls the given function with the index and bounds of every chunk that touches the given area.
+    template <typename Function>
+    void forEachChunkIn(const DirtyRect& area, Function&& function) const {
+        const int beginX = std::max(area.minX, 0) / CHUNK_SIZE, endX = std::min(area.maxX, width - 1) / CHUNK_SIZE;
+        const int beginY = std::max(area.minY, 0) / CHUNK_SIZE, endY = std::min(area.maxY, height - 1) / CHUNK_SIZE;
+        for (int chunkY = beginY; chunkY <= endY; chunkY++) {
+            for (int chunkX = beginX; chunkX <= endX; chunkX++) {
+                const DirtyRect bounds{chunkX * CHUNK_SIZE, chunkY * CHUNK_SIZE,
+                    std::min((chunkX + 1) * CHUNK_SIZE, width) - 1, std::min((chunkY + 1) * CHUNK_SIZE, height) - 1};
+                function(static_cast<size_t>(chunkY) * chunksX() + chunkX, bounds);
+            }
+        }
+    }
+
+    // Checks if any cell in the given area holds a particle with one of the given IDs, one bit per ID.
+    static bool holdsAny(const World& world, const DirtyRect& area, const uint64_t ids) {
+        for (int y = area.minY; y <= area.maxY; y++) {
+            const Cell* cell = &world.cells[static_cast<size_t>(y) * world.width];
+            for (int x = area.minX; x <= area.maxX; x++) {
+                if (ids >> cell[x].id() & 1) return true;
+            }
+        }
+        return false;
+    }
+
+    // Draws the cells from beginX to endX in the given row of the world into the image, by looking up the material of each cell in the palette.
+    // With AVX2, eight cells are read as 32-bit words at once, their materials masked out, and their colors gathered from the palette.
+    void buildRow(const World& world, const int y, const int beginX, const int endX) {
+        const Cell* cell = &world.cells[static_cast<size_t>(y) * world.width];
+        uint32_t* pixel = &pixels[static_cast<size_t>(y) * width];
+        const uint32_t* colors = palette.colors;
+
+        int x = beginX;
+#if defined(__AVX2__)
+        const __m256i materialMask = _mm256_set1_epi32(0xFF); // The material is the lowest byte of a cell.
+        for (; x + 8 <= endX; x += 8) {
+            const __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cell + x));
+            const __m256i materials = _mm256_and_si256(cells, materialMask);
+            const __m256i result = _mm256_i32gather_epi32(reinterpret_cast<const int*>(colors), materials, 4);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixel + x), result);
+        }
+#endif
+        for (; x < endX; x++) {
+            pixel[x] = colors[cell[x].material];
+        }
+    }
+
+    // Turns the unsent rectangles into the regions to upload. The rectangles of neighboring chunks in a row are joined into
+    // a single region, and so are regions that line up on top of each other, so that a falling stream of sand is uploaded in one piece.
+    void findRegions() {
+        regions.clear();
+        const int columns = chunksX();
+        for (int chunkY = 0; chunkY < chunksY(); chunkY++) {
+            DirtyRect run; // The region that the current run of changed chunks is joined into.
+            for (int chunkX = 0; chunkX < columns; chunkX++) {
+                const DirtyRect& rect = unsent[static_cast<size_t>(chunkY) * columns + chunkX];
+                if (rect.empty()) {
+                    if (!run.empty()) addRegion(run);
+                    run = DirtyRect{};
+                } else {
+                    run.include(rect.minX, rect.minY, rect.maxX, rect.maxY);
+                }
+            }
+            if (!run.empty()) addRegion(run);
+        }
+
+        bytesUploaded = 0;
+        for (const DirtyRect& region : regions) {
+            bytesUploaded += static_cast<uint64_t>(region.maxX - region.minX + 1) * (region.maxY - region.minY + 1) * sizeof(uint32_t);
+        }
+    }
+
+    // Adds a region to upload. If a region covers the same columns and ends right above it, that one is grown instead.
+    void addRegion(const DirtyRect& region) {
+        for (DirtyRect& above : regions) {
+            if (above.minX == region.minX && above.maxX == region.maxX && above.maxY + 1 == region.minY) {
+                above.maxY = region.maxY;
+                return;
+            }
+        }
+        regions.push_back(region);
+    }
+};
+
+#endif //FRAME_BUFFER_H
@@ -0,0 +1,277 @@
+#ifndef FRAME_EXPORTER_H
+#define FRAME_EXPORTER_H
+
+#include <atomic> // Includes the atomic library for the counters read by other threads.
+#include <condition_variable> // Includes the condition_variable library for handing frames between the threads.
+#include <csignal> // Includes the csignal library for ignoring closed pipes.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <cstdio> // Includes the cstdio library for writing the file.
+#include <cstring> // Includes the cstring library for copying the palette.
+#include <memory> // Includes the memory library for unique_ptr.
+#include <new> // Includes the new library for bad_alloc.
+#include <mutex> // Includes the mutex library for protecting the queue.
+#include <thread> // Includes the thread library for the writer thread.
+#include <vector> // Includes the vector library for the frames.
+#include "options.h" // Includes the options.h header file.
+#include "world.h" // Includes the world.h header file.
+#include "palette.h" // Includes the palette.h header file.
+#include "scaledFrame.h" // Includes the scaledFrame.h header file.
+
+// Writes every Nth tick of the simulation to a file or a pipe, as a Y4M video or a stream of PPM images, with every cell a block of
+// scale x scale pixels. The simulation only copies the materials of the cells and the palette into a free frame, and queues it.
+// Turning the frames into pixels and writing them happens on a writer thread, so the simulation never waits for the disk,
+// unless every frame is still queued. Those waits are counted as stalls. Scaled frames are scaled up by the same parallel
+// upscaler the window uses on the CPU, with a thread pool of the writer's own.
+class FrameExporter {
+public:
+    static constexpr int QUEUE_SIZE = 4; // The number of frames that can be queued for the writer at once. Each one holds a byte per cell.
+
+    // Opens the file and starts the writer thread. The frame rate written to Y4M files is the tick rate divided by every.
+    // Frames with a scale above 1 are scaled up with the given number of threads.
+    // Frames that are too large to export, or that can't be allocated, leave the exporter invalid, like a file that can't be opened.
+    FrameExporter(const char* path, const ExportFormat format, const int width, const int height, const int every, const int scale, const int threads)
+        : format(format), width(width), height(height), every(every), scale(scale),
+          file(exportSizeValid(width, height, scale) ? fopen(path, "wb") : nullptr),
+          camera(width, height, width * scale, height * scale, scale) {
+        if (!file) return;
+
+#ifdef SIGPIPE
+        // A reader that closes the pipe early would otherwise kill the program. Ignored, the write fails and is reported like any other.
+        signal(SIGPIPE, SIG_IGN);
+#endif
+
+        try {
+            for (int i = 0; i < QUEUE_SIZE; i++) {
+                frames[i].materials.resize(static_cast<size_t>(width) * height);
+                freeFrames[i] = i;
+            }
+            freeCount = QUEUE_SIZE;
+            encoded.reserve(static_cast<size_t>(width) * height * scale * scale * 3 + 64);
+
+            if (scale > 1) {
+                source = std::make_unique<FrameBuffer>(width, height);
+                scaled = std::make_unique<ScaledFrame>(width * scale, height * scale);
+                pool = std::make_unique<ThreadPool>(threads);
+                wholeWorld.assign(1, DirtyRect{0, 0, width - 1, height - 1});
+            }
+        } catch (const std::bad_alloc&) {
+            fclose(file);
+            file = nullptr;
+            return;
+        }
+
+        if (format == ExportFormat::Y4m) {
+            // 4:4:4, so that every cell keeps its own color, instead of sharing it with its neighbors.
+            fprintf(file, "YUV4MPEG2 W%d H%d F%d:%d Ip A1:1 C444\n", width * scale, height * scale, TARGET_FPS, every);
+        }
+        writer = std::thread([this] { writeLoop(); });
+    }
+
+    ~FrameExporter() {
+        finish();
+    }
+
+    FrameExporter(const FrameExporter&) = delete;
+    FrameExporter& operator=(const FrameExporter&) = delete;
+
+    // Checks if the file was opened successfully.
+    bool valid() const {
+        return file != nullptr;
+    }
+
+    // Called after every tick. On every Nth tick, queues a copy of the world for the writer.
+    // Waits for the writer only if every frame is still queued, and counts the wait as a stall.
+    void onTick(const World& world) {
+        if (ticks++ % every != 0 || failed() || !writer.joinable()) return;
+
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (freeCount == 0) {
+                stallCount.fetch_add(1, std::memory_order_relaxed);
+                frameFreed.wait(lock, [this] { return freeCount > 0; });
+            }
+            index = freeFrames[--freeCount];
+        }
+
+        // The writer never touches a free frame, so it is filled without holding the lock.
+        Frame& frame = frames[index];
+        const Cell* cell = world.cells.data();
+        for (uint8_t& material : frame.materials) material = (cell++)->material;
+        memcpy(frame.colors, palette.colors, sizeof(frame.colors));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue[(queueStart + queueCount) % QUEUE_SIZE] = index;
+            queueCount++;
+        }
+        frameQueued.notify_one();
+    }
+
+    // Writes the frames that are still queued, stops the writer thread and closes the file. No frames are queued after that.
+    void finish() {
+        if (!writer.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        frameQueued.notify_one();
+        writer.join();
+        if (fclose(file) != 0) writeFailed.store(true, std::memory_order_relaxed);
+    }
+
+    // The number of frames written so far.
+    uint64_t framesWritten() const {
+        return writtenCount.load(std::memory_order_relaxed);
+    }
+
+    // The number of times the simulation had to wait for the writer, because the queue was full.
+    uint64_t stalls() const {
+        return stallCount.load(std::memory_order_relaxed);
+    }
+
+    // Checks if writing failed, like when the other end of a pipe was closed. No frames are queued after that.
+    bool failed() const {
+        return writeFailed.load(std::memory_order_relaxed);
+    }
+
+private:
+    // A copy of the world to write. Only the materials are copied, as the palette turns them into colors.
+    struct Frame {
+        std::vector<uint8_t> materials;
+        uint32_t colors[256];
+    };
+
+    const ExportFormat format;
+    const int width;
+    const int height;
+    const int every; // Writes one in this many ticks.
+    const int scale; // The size of each cell in the written frames, in pixels.
+    FILE* file;
+    uint64_t ticks = 0; // The number of ticks seen so far. Only used by the simulation thread.
+
+    Frame frames[QUEUE_SIZE];
+    std::mutex mutex;
+    std::condition_variable frameQueued; // Wakes the writer up when a frame is queued.
+    std::condition_variable frameFreed; // Wakes the simulation up when a frame was written, if it is waiting for one.
+    int freeFrames[QUEUE_SIZE]; // The frames that aren't queued. Protected by the mutex.
+    int freeCount = 0;
+    int queue[QUEUE_SIZE]; // The queued frames, oldest first, including the one being written. Protected by the mutex.
+    int queueStart = 0;
+    int queueCount = 0;
+    bool stopping = false; // Protected by the mutex.
+
+    std::atomic<uint64_t> writtenCount{0};
+    std::atomic<uint64_t> stallCount{0};
+    std::atomic<bool> writeFailed{false};
+
+    std::vector<uint8_t> encoded; // The bytes of the frame being written. Only used by the writer thread.
+    Camera camera; // Looks at the whole world, with each cell scale x scale pixels.
+    std::unique_ptr<FrameBuffer> source; // The frame with one pixel per cell, before it is scaled up. Only used if scale is above 1.
+    std::unique_ptr<ScaledFrame> scaled; // The frame scaled up.
+    std::unique_ptr<ThreadPool> pool; // The threads that scale the frames up and convert them.
+    std::vector<DirtyRect> wholeWorld; // The single region that is scaled up, kept so that it doesn't allocate every frame.
+    std::thread writer;
+
+    // Writes the queued frames in order, until the exporter is destroyed and the queue is empty.
+    void writeLoop() {
+        while (true) {
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                frameQueued.wait(lock, [this] { return queueCount > 0 || stopping; });
+                if (queueCount == 0) return;
+                index = queue[queueStart];
+            }
+
+            // The frame stays in the queue while it is written, so that it isn't handed out again.
+            if (!failed()) {
+                encode(frames[index]);
+                if (fwrite(encoded.data(), 1, encoded.size(), file) != encoded.size()) writeFailed.store(true, std::memory_order_relaxed);
+                else writtenCount.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queueStart = (queueStart + 1) % QUEUE_SIZE;
+                queueCount--;
+                freeFrames[freeCount++] = index;
+            }
+            frameFreed.notify_one();
+        }
+    }
+
+    // Turns a frame into the bytes of the file. Frames at one pixel per cell are converted cell by cell,
+    // with the color of every material converted once and then looked up for every cell.
+    void encode(const Frame& frame) {
+        const size_t cells = frame.materials.size();
+        char header[64];
+        const int headerSize = format == ExportFormat::Y4m ? snprintf(header, sizeof(header), "FRAME\n")
+            : snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width * scale, height * scale);
+        encoded.assign(header, header + headerSize);
+        encoded.resize(headerSize + cells * scale * scale * 3);
+        uint8_t* out = encoded.data() + headerSize;
+
+        if (scale > 1) {
+            encodeScaled(frame, out);
+            return;
+        }
+
+        if (format == ExportFormat::Ppm) {
+            // Interleaved red, green and blue bytes.
+            for (size_t i = 0; i < cells; i++) {
+                const uint32_t color = frame.colors[frame.materials[i]];
+                out[i * 3] = static_cast<uint8_t>(color >> 16);
+                out[i * 3 + 1] = static_cast<uint8_t>(color >> 8);
+                out[i * 3 + 2] = static_cast<uint8_t>(color);
+            }
+            return;
+        }
+
+        // A plane of luma, followed by a plane of each chroma.
+        uint8_t planes[3][256];
+        for (int material = 0; material < 256; material++) {
+            toYuv(frame.colors[material], planes[0][material], planes[1][material], planes[2][material]);
+        }
+        for (const uint8_t* plane : planes) {
+            for (size_t i = 0; i < cells; i++) out[i] = plane[frame.materials[i]];
+            out += cells;
+        }
+    }
+
+    // Turns a frame into the bytes of the file, with every cell a block of scale x scale pixels. The frame is drawn through the palette,
+    // scaled up in parallel stripes, and converted in parallel stripes as well, as a scaled frame has many more pixels than cells.
+    void encodeScaled(const Frame& frame, uint8_t* out) {
+        for (size_t i = 0; i < frame.materials.size(); i++) source->pixels[i] = frame.colors[frame.materials[i]];
+        scaled->upscale(*source, wholeWorld, camera, *pool);
+
+        const size_t pixels = scaled->pixels.size();
+        const uint32_t* in = scaled->pixels.data();
+        const int rows = scaled->height;
+        const int stripes = std::min(rows, pool->size() * 4);
+        const int rowPixels = scaled->width;
+        pool->run(stripes, [&](const int stripe) {
+            const size_t begin = static_cast<size_t>(static_cast<int64_t>(rows) * stripe / stripes) * rowPixels;
+            const size_t end = static_cast<size_t>(static_cast<int64_t>(rows) * (stripe + 1) / stripes) * rowPixels;
+            if (format == ExportFormat::Ppm) {
+                for (size_t i = begin; i < end; i++) {
+                    out[i * 3] = static_cast<uint8_t>(in[i] >> 16);
+                    out[i * 3 + 1] = static_cast<uint8_t>(in[i] >> 8);
+                    out[i * 3 + 2] = static_cast<uint8_t>(in[i]);
+                }
+            } else {
+                for (size_t i = begin; i < end; i++) toYuv(in[i], out[i], out[pixels + i], out[pixels * 2 + i]);
+            }
+        });
+    }
+
+    // Converts a pixel to luma and chroma, using the BT.601 studio range conversion that players expect.
+    static void toYuv(const uint32_t color, uint8_t& y, uint8_t& u, uint8_t& v) {
+        const int r = color >> 16 & 0xFF, g = color >> 8 & 0xFF, b = color & 0xFF;
+        y = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        u = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        v = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+};
+
+#endif //FRAME_EXPORTER_H
@@ -0,0 +1,86 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include <chrono> // Includes the chrono library for the high resolution clock.
+#include <thread> // Includes the thread library for sleeping and yielding.
+
+// The clock used for pacing. Monotonic, with at least microsecond resolution, the same clock SDL's performance counter reads on most platforms.
+// It doesn't depend on SDL, so the simulation thread can use it as well.
+using SchedulerClock = std::chrono::steady_clock;
+
+// How long before a deadline sleeping stops, and the thread spins instead. Sleeps can wake up a millisecond or more late,
+// so the last part of the wait is spent checking the clock, which is accurate to a few microseconds.
+constexpr SchedulerClock::duration SPIN_TIME = std::chrono::microseconds(1500);
+
+// Converts a time in seconds to a duration of the clock, without rounding it to whole milliseconds.
+inline SchedulerClock::duration secondsToDuration(const double seconds) {
+    return std::chrono::duration_cast<SchedulerClock::duration>(std::chrono::duration<double>(seconds));
+}
+
+// Waits until the given time. Sleeps for most of the wait, and spins for the rest.
+inline void sleepUntil(const SchedulerClock::time_point deadline) {
+    if (deadline - SchedulerClock::now() > SPIN_TIME) std::this_thread::sleep_until(deadline - SPIN_TIME);
+    while (SchedulerClock::now() < deadline) std::this_thread::yield();
+}
+
+// Paces a loop that runs once per period, like the drawing of frames.
+class FrameScheduler {
+public:
+    explicit FrameScheduler(const double period) : period(secondsToDuration(period)), next(SchedulerClock::now()) {}
+
+    // Waits until the next period starts. If the loop fell behind, it starts over from now instead of trying to catch up.
+    void wait() {
+        next += period;
+        const auto now = SchedulerClock::now();
+        if (next < now) next = now;
+        else sleepUntil(next);
+    }
+
+private:
+    const SchedulerClock::duration period;
+    SchedulerClock::time_point next; // When the next period starts.
+};
+
+// Runs the simulation with a fixed timestep. The time that passes is added to an accumulator, and every whole tick in it is run,
+// so the simulation keeps its speed when a tick or a frame takes too long, by running several ticks in a row.
+class FixedTimestep {
+public:
+    // The most ticks run in a row. If the simulation falls further behind than this, like when the window was being dragged
+    // or a tick is simply slower than the tick time, the rest is dropped, so it doesn't spend all its time catching up.
+    static constexpr int MAX_TICKS_IN_A_ROW = 4;
+
+    explicit FixedTimestep(const double tickTime) : tickTime(secondsToDuration(tickTime)), last(SchedulerClock::now()) {}
+
+    // Adds the time since the last call to the accumulator, and takes the ticks that are due out of it. Returns how many there are.
+    int ticksDue() {
+        const auto now = SchedulerClock::now();
+        accumulator += now - last;
+        last = now;
+
+        const int ticks = static_cast<int>(accumulator / tickTime);
+        if (ticks > MAX_TICKS_IN_A_ROW) {
+            accumulator = SchedulerClock::duration::zero();
+            return MAX_TICKS_IN_A_ROW;
+        }
+        accumulator -= ticks * tickTime;
+        return ticks;
+    }
+
+    // Forgets the time that passed since the last call, like after the simulation ran on its own clock for a while.
+    void reset() {
+        accumulator = SchedulerClock::duration::zero();
+        last = SchedulerClock::now();
+    }
+
+    // Waits until the next tick is due.
+    void waitForTick() const {
+        sleepUntil(last + (tickTime - accumulator));
+    }
+
+private:
+    const SchedulerClock::duration tickTime;
+    SchedulerClock::duration accumulator{}; // The time that passed and hasn't been simulated yet.
+    SchedulerClock::time_point last; // The last time the accumulator was updated.
+};
+
+#endif //FRAME_SCHEDULER_H
@@ -1,20 +1,44 @@
 #ifndef GLOBALS_H
 #define GLOBALS_H
 
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
 #include <vector> // Includes the vector library for vectors.
 #include <array> // Includes the array library for arrays.
 #include <random> // Includes the random library for generating random numbers.
 #include <algorithm> // Includes the algorithm library for shuffling arrays.
+#include "random.h" // Includes the random.h header file.
 
 // Global constants. These are used throughout the program, and can be modified before building.
 constexpr int TARGET_FPS = 60;
-constexpr int TARGET_FRAME_TIME = 1000 / TARGET_FPS; // In milliseconds.
+constexpr double TARGET_FRAME_TIME = 1.0 / TARGET_FPS; // In seconds. Not rounded to whole milliseconds, so that 60 fps is really 60 fps.
+constexpr int IDLE_WAIT_TIME = 250; // The longest the window sleeps while nothing happens, in milliseconds.
 
 constexpr int WIDTH = 1920; // The width of the window.
 constexpr int HEIGHT = 1080; // The height of the window.
 constexpr float GRAVITY = 9.81f; // The gravity constant. Used for particles that are affected by gravity.
 constexpr int PARTICLE_SIZE = 4; // The size of each particle.
 
+constexpr int SIMULATION_THREADS = 0; // The number of threads used to update the world. 0 uses one thread per core.
+constexpr uint64_t SIMULATION_SEED = 0; // The seed used for the simulation's random numbers. 0 picks a random seed at startup.
+
+// The orders in which the cells of a chunk can be updated. Updating in a fixed order makes the particles drift in one direction,
+// so each order is randomized in some way, with different trade-offs between cost and how random the order is.
+enum class TraversalOrder {
+    Shuffled, // Shuffles the order of the cells every frame. The most random, but also the most expensive.
+    RotatingPermutations, // Cycles through a few orders that are shuffled once at startup.
+    AlternatingRows, // Goes through the rows from the bottom up, alternating the direction of each row, in a pattern that changes every frame.
+    RandomRows // Goes through the rows from the bottom up, picking a random direction for each row.
+};
+
+// Where the random numbers used by the particles come from.
+enum class RandomMode {
+    Streams, // Each chunk has its own stream of random numbers. Fast, but the numbers a cell gets depend on the order the chunk is updated in.
+    Counter // Each cell gets random numbers based only on the seed, the frame and its position, no matter how the updates are ordered.
+};
+
+constexpr RandomMode RANDOM_MODE = RandomMode::Streams; // Where the random numbers used by the particles come from.
+constexpr TraversalOrder TRAVERSAL_ORDER = TraversalOrder::RandomRows; // The order in which the cells are updated.
+
 // A boolean that determines if the simulation is paused or not.
 inline int paused = false;
 
@@ -30,6 +54,15 @@ inline int lastMouse[2] = {0, 0};
 
 inline std::random_device rd; // A random device used to generate random numbers.
 
+// The random number service. Every random number generator in the simulation is derived from its seed.
+inline RandomService randomService;
+
+// Gets the random number generator of the current thread. Used for things outside the simulation, like placing particles with the brush.
+inline Random& threadRandom() {
+    thread_local Random random = randomService.threadStream();
+    return random;
+}
+
 // A color type that stores the red, green, and blue components of a color.
 typedef struct color_t {
     uint8_t r, g, b;
@@ -44,25 +77,6 @@ constexpr color_t stoneColor[3] = {{150, 150, 152}, {140, 140, 142}, {130, 130,
 constexpr color_t gunpowderColor[3] = {{30, 30, 30}, {25, 25, 25}, {20, 20, 20}};
 constexpr color_t fireColor[3] = {{255, 0, 0}, {255, 90, 0}, {255, 154, 0}};
 
-// A particle class that is used as a base class for all the different particle types.
-class Particle {
-public:
-    uint8_t id{}; // The ID of the particle. Used to determine the type of the particle.
-    float lifeTime{}; // The max life time of the particle. Currently unused.
-    std::array<int, 2> position{}; // The x and y position of the particle.
-    std::array<float, 2> velocity{}; // The x and y velocity of the particle.
-    color_t color{}; // The color of the particle.
-    bool updatedThisFrame{}; // Checks if the particle has been updated this iteration to prevent it from being updated multiple times.
-
-    virtual void update() {}; // The simulation function for the particle. To be implemented by the child classes.
-    virtual void render(SDL_Renderer* renderer, int x, int y) {}; // The rendering function for the particle. To be implemented by the child classes.
-
-    virtual ~Particle() = default; // The destructor for the particle.
-};
-
-// The array of particles that make up the world. Defined as a pointer instead of an actual array to be more efficient.
-inline Particle** worldParticleData;
-
 enum class ParticleType {
     Sand,
     Stone,
@@ -70,8 +84,4 @@ enum class ParticleType {
     Fire
 };
 
-// A list of all the particle types, as well as an index to cycle through it.
-inline std::vector<ParticleType> particleTypes = {ParticleType::Sand, ParticleType::Stone, ParticleType::Gunpowder, ParticleType::Fire};
-inline int currentParticleTypeIndex = 0;
-
 #endif //GLOBALS_H
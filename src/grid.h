@@ -0,0 +1,114 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include "world.h"
+
+// The size of a world, known at compile time. A size of 0 means the size is only known at runtime.
+template <int Width, int Height>
+struct GridSize {
+    static constexpr int width = Width;
+    static constexpr int height = Height;
+};
+
+// The size used by the generic kernels, which read the size of the world at runtime.
+using RuntimeSize = GridSize<0, 0>;
+
+// A list of world sizes.
+template <typename... Sizes>
+struct GridSizeList {};
+
+// The standard world sizes, which get their own specialized kernels. Any other size uses the generic kernels.
+// 480x270 is the size of the default window, divided by the default particle size.
+using StandardGridSizes = GridSizeList<GridSize<480, 270>, GridSize<1024, 1024>, GridSize<4096, 4096>, GridSize<8192, 8192>>;
+
+// Calls the given function with the standard size that matches the given size, or with RuntimeSize if none of them match.
+template <typename Function, typename... Sizes>
+void dispatchGridSize(GridSizeList<Sizes...>, const int width, const int height, Function&& function) {
+    const bool found = ((width == Sizes::width && height == Sizes::height ? (function(Sizes{}), true) : false) || ...);
+    if (!found) function(RuntimeSize{});
+}
+
+// A view of the world used by the kernels. If the size of the world is known at compile time, the stride and bounds are constants,
+// which makes the index math and bounds checks cheaper. Otherwise, the size is copied out of the world, so that it can be kept in registers.
+template <typename Size>
+class WorldView {
+public:
+    explicit WorldView(World& world)
+        : world(world), cells(world.cells.data()), runtimeWidth(world.width), runtimeHeight(world.height), stamp(world.stamp) {}
+
+    int width() const {
+        return Size::width > 0 ? Size::width : runtimeWidth;
+    }
+
+    int height() const {
+        return Size::height > 0 ? Size::height : runtimeHeight;
+    }
+
+    // Checks if the given position is within the bounds of the world.
+    bool inBounds(const int x, const int y) const {
+        return static_cast<unsigned>(x) < static_cast<unsigned>(width()) && static_cast<unsigned>(y) < static_cast<unsigned>(height());
+    }
+
+    int index(const int x, const int y) const {
+        return y * width() + x;
+    }
+
+    Cell& at(const int x, const int y) {
+        return cells[index(x, y)];
+    }
+
+    Cell& at(const int i) {
+        return cells[i];
+    }
+
+    // Checks if the given position is within the bounds of the world and empty.
+    bool isEmpty(const int x, const int y) {
+        return inBounds(x, y) && at(x, y).id() == 0;
+    }
+
+    // Sets the cell at the given position.
+    void set(const int x, const int y, const Cell& cell) {
+        at(x, y) = cell;
+        world.markDirty(x, y);
+    }
+
+    // Removes the particle at the given position.
+    void clear(const int x, const int y) {
+        at(x, y) = Cell{};
+        world.markDirty(x, y);
+    }
+
+    // Moves a particle from one position to another, leaving the old position empty.
+    void move(const int fromX, const int fromY, const int toX, const int toY) {
+        Cell& from = at(fromX, fromY);
+        at(toX, toY) = from;
+        from = Cell{};
+        world.markDirty(fromX, fromY);
+        world.markDirty(toX, toY);
+    }
+
+    void markDirty(const int x, const int y) {
+        world.markDirty(x, y);
+    }
+
+    void countDiagonalMove(const int x, const int y, const int direction) {
+        world.countDiagonalMove(x, y, direction);
+    }
+
+    bool updatedThisFrame(const Cell& cell) const {
+        return cell.stamp == stamp;
+    }
+
+    void markUpdated(Cell& cell) const {
+        cell.stamp = stamp;
+    }
+
+private:
+    World& world;
+    Cell* cells;
+    const int runtimeWidth;
+    const int runtimeHeight;
+    const uint8_t stamp;
+};
+
+#endif //GRID_H
@@ -0,0 +1,173 @@
+#include <chrono> // Includes the chrono library for timing the simulation.
+#include <cstdio> // Includes the cstdio library for printing the results.
+#include <fstream> // Includes the fstream library for reading scene files.
+#include <memory> // Includes the memory library for unique_ptr.
+#include <string> // Includes the string library for reading scene files.
+#include "globals.h" // Includes the globals.h header file.
+#include "options.h" // Includes the options.h header file.
+#include "world.h" // Includes the world.h header file.
+#include "stats.h" // Includes the stats.h header file.
+#include "particleRegistry.h" // Includes the particle registry, which includes all particle types.
+#include "simulation.h" // Includes the simulation.h header file.
+#include "frameExporter.h" // Includes the frameExporter.h header file.
+
+// Loads a text scene into the world. Each line is a row of cells, starting from the top left corner of the world.
+bool loadScene(World& world, const char* path, Random& rng) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    for (int y = 0; y < world.height && std::getline(file, line); y++) {
+        for (int x = 0; x < world.width && x < static_cast<int>(line.size()); x++) {
+            const Cell cell = ParticleRegistry::fromSymbol(line[x], rng);
+            if (cell.id() != 0) world.set(x, y, cell);
+        }
+    }
+    return true;
+}
+
+// Fills the given share of the world with random particles.
+void fillRandom(World& world, const double fill, Random& rng) {
+    const uint32_t threshold = static_cast<uint32_t>(fill * 4294967295.0);
+    for (int y = 0; y < world.height; y++) {
+        for (int x = 0; x < world.width; x++) {
+            if (rng() < threshold) {
+                world.set(x, y, ParticleRegistry::create(particleTypes[rng.below(particleTypes.size())], rng));
+            }
+        }
+    }
+}
+
+// Hashes the particles in the world, so that two runs can be compared.
+uint64_t hashWorld(const World& world) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const Cell& cell : world.cells) {
+        hash = (hash ^ cell.material) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// The results of a single benchmark run.
+struct BenchmarkResult {
+    double seconds = 0.0;
+    double bias = 0.0;
+    uint64_t allocations = 0; // The number of heap allocations after the warmup frames.
+    uint64_t hash = 0;
+    int threads = 0;
+    bool specialized = false; // Whether the kernels were specialized for the size of the world.
+};
+
+// Builds the starting world, runs the simulation for the given number of ticks and measures it. Returns false if the scene could not be loaded.
+// If an exporter is given, it is handed every tick, and the time spent queuing frames counts towards the run.
+bool runBenchmark(const bool specializedKernels, BenchmarkResult& result, FrameExporter* exporter) {
+    // Allocates the world and creates the simulation.
+    World world(options.resolvedWorldWidth(), options.resolvedWorldHeight());
+    Simulation simulation(world, options.resolvedThreads(), options.seed, options.order, options.randomMode, specializedKernels);
+
+    // Builds the starting world, either from a scene or from a random fill.
+    Random sceneRandom = randomService.stream(1);
+    if (!options.scene.empty()) {
+        if (!loadScene(world, options.scene.c_str(), sceneRandom)) {
+            fprintf(stderr, "Could not open the scene %s\n", options.scene.c_str());
+            return false;
+        }
+    } else {
+        fillRandom(world, options.fill, sceneRandom);
+    }
+
+    // Runs the simulation, keeping track of the heap allocations of every frame.
+    SimulationStats stats;
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int tick = 0; tick < options.ticks; tick++) {
+        stats.beginFrame();
+        simulation.update();
+        if (exporter) exporter->onTick(world);
+        stats.endFrame();
+    }
+    const auto endTime = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration<double>(endTime - startTime).count();
+    result.bias = simulation.bias();
+    result.allocations = stats.steadyStateAllocations;
+    result.hash = hashWorld(world);
+    result.threads = simulation.threads();
+    result.specialized = simulation.specializedKernels();
+    return true;
+}
+
+// Prints the results of a benchmark run.
+void printResult(const BenchmarkResult& result) {
+    const double ticksPerSecond = result.seconds > 0.0 ? options.ticks / result.seconds : 0.0;
+    const double cellsPerSecond = ticksPerSecond * options.resolvedWorldWidth() * options.resolvedWorldHeight();
+
+    printf("world: %dx%d cells, %d threads, seed %llu\n", options.resolvedWorldWidth(), options.resolvedWorldHeight(), result.threads,
+        static_cast<unsigned long long>(options.seed));
+    printf("kernels: %s\n", result.specialized ? "specialized" : "generic");
+    printf("ticks: %d in %.3f s\n", options.ticks, result.seconds);
+    printf("ticks/sec: %.1f\n", ticksPerSecond);
+    printf("cells/sec: %.3e\n", cellsPerSecond);
+    printf("bias: %+.4f\n", result.bias);
+    printf("allocations after warmup: %llu\n", static_cast<unsigned long long>(result.allocations));
+    printf("world hash: %016llx\n", static_cast<unsigned long long>(result.hash));
+}
+
+// Waits for the exporter to write the frames that are still queued, and prints how it went. Returns false if writing failed.
+bool finishExport(FrameExporter* exporter) {
+    if (!exporter) return true;
+    exporter->finish();
+    if (exporter->failed()) {
+        fprintf(stderr, "Could not write to %s after %llu frames\n", options.exportPath.c_str(),
+            static_cast<unsigned long long>(exporter->framesWritten()));
+        return false;
+    }
+    printf("exported: %llu frames to %s, %llu stalls\n", static_cast<unsigned long long>(exporter->framesWritten()),
+        options.exportPath.c_str(), static_cast<unsigned long long>(exporter->stalls()));
+    return true;
+}
+
+// Runs the simulation without a window, as fast as possible, and prints how fast it ran.
+int main(int argc, char* argv[]) {
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    options.resolveSeed();
+
+    // Opens the file to export the ticks to, if one was given. With compare, only the run with the specialized kernels is exported.
+    std::unique_ptr<FrameExporter> exporter;
+    if (!options.exportPath.empty()) {
+        exporter = std::make_unique<FrameExporter>(options.exportPath.c_str(), options.exportFormat,
+            options.resolvedWorldWidth(), options.resolvedWorldHeight(), options.exportEvery,
+            options.exportScale, options.resolvedThreads());
+        if (!exporter->valid()) {
+            fprintf(stderr, "Could not open %s for exporting, or its frames don't fit in memory\n", options.exportPath.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.kernels != KernelMode::Compare) {
+        BenchmarkResult result;
+        if (!runBenchmark(options.kernels == KernelMode::Specialized, result, exporter.get())) return EXIT_FAILURE;
+        printResult(result);
+        return finishExport(exporter.get()) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Runs the same world with the generic and the specialized kernels. Both must end up with the same world.
+    BenchmarkResult generic, specialized;
+    if (!runBenchmark(false, generic, nullptr) || !runBenchmark(true, specialized, exporter.get())) return EXIT_FAILURE;
+    if (!finishExport(exporter.get())) return EXIT_FAILURE;
+    printResult(generic);
+    printf("\n");
+    printResult(specialized);
+    printf("\n");
+
+    if (!specialized.specialized) printf("note: %dx%d is not a standard size, so both runs used the generic kernels.\n",
+        options.resolvedWorldWidth(), options.resolvedWorldHeight());
+    printf("speedup: %.2fx\n", specialized.seconds > 0.0 ? generic.seconds / specialized.seconds : 0.0);
+    if (generic.hash != specialized.hash) {
+        fprintf(stderr, "The generic and specialized kernels ended up with different worlds.\n");
+        return EXIT_FAILURE;
+    }
+    printf("worlds match\n");
+    return EXIT_SUCCESS;
+}
@@ -1,60 +1,146 @@
 #include <SDL.h> // Includes the SDL library for creating windows and rendering graphics.
+#include <memory> // Includes the memory library for unique_ptr.
 #include "globals.h" // Includes the globals.h header file.
-
-// Includes all particle types.
-#include "sandParticle.h"
-#include "stoneParticle.h"
-#include "gunpowderParticle.h"
-#include "fireParticle.h"
-
-// Defines the setPixel and drawCircle function.
-void setPixel(SDL_Renderer* renderer, int x, int y, SDL_Color color);
-void drawCircle(SDL_Renderer* renderer, int centerX, int centerY, int radius);
-
-// Defines the interpolate function. Used for drawing the particles in an interpolated way.
-void interpolate(int x1, int y1, int x2, int y2);
+#include "options.h" // Includes the options.h header file.
+#include "world.h" // Includes the world.h header file.
+#include "stats.h" // Includes the stats.h header file.
+
+// Includes the particle registry, which includes all particle types.
+#include "particleRegistry.h"
+#include "simulation.h" // Includes the simulation.h header file.
+#include "frameBuffer.h" // Includes the frameBuffer.h header file.
+#include "renderer.h" // Includes the renderer.h header file.
+#include "simulationThread.h" // Includes the simulationThread.h header file.
+#include "camera.h" // Includes the camera.h header file.
+#include "overlay.h" // Includes the overlay.h header file.
+#include "frameScheduler.h" // Includes the frameScheduler.h header file.
 
 // The main function. Where the program starts.
 int main(int argc, char* argv[]) {
+    // Reads the options from the command line, and exits if they are invalid.
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    options.resolveSeed();
+
     if (SDL_Init(SDL_INIT_EVERYTHING) != 0) return EXIT_FAILURE; // Initializes the SDL library.
 
     // Creates a window.
     SDL_Window* window = SDL_CreateWindow("Falling Sand Simulation C++", SDL_WINDOWPOS_UNDEFINED,
-        SDL_WINDOWPOS_UNDEFINED, WIDTH, HEIGHT, SDL_WINDOW_SHOWN);
+        SDL_WINDOWPOS_UNDEFINED, options.windowWidth, options.windowHeight, SDL_WINDOW_SHOWN);
     if (!window) { SDL_Quit(); return EXIT_FAILURE; } // Checks if the window was created successfully, and exits if not.
 
-    // Creates a renderer.
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    if (!renderer) { SDL_DestroyWindow(window); SDL_Quit(); return EXIT_FAILURE; } // Checks if the renderer was created successfully, and exits if not.
-
-    // Allocates memory for worldParticleData. Basically just sets the size of the array.
-    worldParticleData = new Particle*[(WIDTH / PARTICLE_SIZE) * (HEIGHT / PARTICLE_SIZE)]();
-
-    // Generates a random seed to be used when generating random numbers.
-    std::mt19937 g(rd());
+    // Allocates the world. All cells are stored in a single contiguous array, and start out empty.
+    World world(options.resolvedWorldWidth(), options.resolvedWorldHeight());
+
+    // Creates the renderer, which shows the images of the world published by the simulation thread. Waits for the display unless uncapped.
+    const bool uncapped = options.pacing == PacingMode::Uncapped;
+    auto worldRenderer = std::make_unique<Renderer>(window, world.width, world.height, options.windowWidth, options.windowHeight,
+        options.softwareRenderer, !uncapped, options.upscale, options.resolvedThreads());
+    if (!worldRenderer->valid()) { worldRenderer.reset(); SDL_DestroyWindow(window); SDL_Quit(); return EXIT_FAILURE; } // Checks if the renderer was created successfully, and exits if not.
+    SDL_Renderer* renderer = worldRenderer->sdl();
+
+    // Creates the simulation, which updates the world one frame at a time, using the configured number of threads and seed.
+    Simulation simulation(world, options.resolvedThreads(), options.seed, options.order, options.randomMode,
+        options.kernels != KernelMode::Generic);
+
+    // The camera, which starts out showing the top left corner of the world, with each cell the size of a particle.
+    Camera camera(world.width, world.height, options.windowWidth, options.windowHeight, options.particleSize);
+    int panRemainder[2] = {0, 0}; // The part of a middle mouse drag that is smaller than a cell, in pixels.
+
+    // Opens the file to export the ticks to, if one was given, and exits if it can't be opened or its frames can't be allocated.
+    std::unique_ptr<FrameExporter> exporter;
+    if (!options.exportPath.empty()) {
+        exporter = std::make_unique<FrameExporter>(options.exportPath.c_str(), options.exportFormat, world.width, world.height,
+            options.exportEvery, options.exportScale, options.resolvedThreads());
+        if (!exporter->valid()) {
+            fprintf(stderr, "Could not open %s for exporting, or its frames don't fit in memory\n", options.exportPath.c_str());
+            worldRenderer.reset(); SDL_DestroyWindow(window); SDL_Quit(); return EXIT_FAILURE;
+        }
+    }
 
-    // Creates a vector of indices to be shuffled later.
-    std::vector<int> indices((WIDTH / PARTICLE_SIZE) * (HEIGHT / PARTICLE_SIZE));
-    std::iota(indices.begin(), indices.end(), 0); // Fills indices with consecutive numbers.
+    // Runs the simulation on its own thread, so that waiting for the display doesn't slow it down.
+    // The overview images are made to fit in the window.
+    auto simulationThread = std::make_unique<SimulationThread>(world, simulation, camera.visibleCells(), options.windowWidth, options.windowHeight,
+        uncapped, exporter.get());
+    Overlay overlay; // The brush outline and the outlines on the minimap, drawn on top of the world in one go.
+    RenderSnapshot* snapshot = nullptr; // The most recent image of the world, which belongs to the main thread until the next one is taken.
 
     SDL_Event e;
     bool running = true;
+    FrameScheduler frameScheduler(TARGET_FRAME_TIME); // Paces the frames when the display doesn't.
+
+    SimulationStats stats; // The statistics of the last tick shown.
+    uint32_t lastTitleUpdate = 0; // The last time the window title was updated with the statistics.
+    char title[512];
 
     bool spacePressed = false; // A boolean that determines if the space key is pressed. Used to prevent the simulation from pausing and unpausing multiple times.
+    bool turbo = false; // Whether the simulation runs as fast as it can, instead of at the target tick rate.
+    bool showOverview = false; // Whether the whole world is shown scaled down to fit in the window, instead of what the camera sees.
+    HeatmapMode heatmapMode = HeatmapMode::Off; // What the heatmap over the world shows, if anything.
+    bool navigating = false; // Whether the left mouse button was pressed on the minimap or the overview, so it moves the camera instead of painting.
 
     // Creates a loop that runs until running is false.
     while (running) {
         const uint32_t startTime = SDL_GetTicks(); // Get the start time.
 
-        while (SDL_PollEvent(&e)) {
+        const Camera lastCamera = camera; // Used to tell the simulation thread when the camera moves.
+
+        // Takes the most recent image of the world, if there is a new one. Checks if the simulation is idle first,
+        // so that an image published right before it went idle is never missed.
+        const bool simulationIdle = simulationThread->idle();
+        RenderSnapshot* newSnapshot = simulationThread->acquire();
+        bool changed = newSnapshot != nullptr; // Whether anything happened that has to be shown.
+
+        // Handles the events since the last frame. If the simulation is idle and there is no new image, nothing can change
+        // until the next event, so it sleeps until then instead of drawing the same frame again.
+        const bool wait = simulationIdle && !changed;
+        for (bool pending = wait ? SDL_WaitEventTimeout(&e, IDLE_WAIT_TIME) == 1 : SDL_PollEvent(&e) == 1; pending; pending = SDL_PollEvent(&e) == 1) {
+            changed = true;
             if (e.type == SDL_QUIT) running = false; // Sets running to false if the user closes the window.
 
             // Handles mouse wheel events.
             if (e.type == SDL_MOUSEWHEEL) {
-                // Increases or decreases brushSize based on the amount scrolled.
-                brushSize += e.wheel.y;
-                // Ensures brushSize is within the range [0, 100].
-                brushSize = std::max(0, std::min(brushSize, 100));
+                if (SDL_GetModState() & KMOD_CTRL) {
+                    // Zooms in or out around the mouse if control is held.
+                    camera.zoomAt(mouse[0], mouse[1], camera.zoom + e.wheel.y);
+                } else {
+                    // Increases or decreases brushSize based on the amount scrolled.
+                    brushSize += e.wheel.y;
+                    // Ensures brushSize is within the range [0, 100].
+                    brushSize = std::max(0, std::min(brushSize, 100));
+                }
+            }
+
+            // Moves the camera to the cell clicked on the minimap or the overview, and keeps following the mouse while the button is held.
+            if (e.type == SDL_MOUSEBUTTONDOWN && e.button.button == SDL_BUTTON_LEFT) {
+                const SDL_Rect map = showOverview ? worldRenderer->overviewRect() : worldRenderer->minimapRect();
+                int cellX, cellY;
+                if (worldRenderer->mapToWorld(map, e.button.x, e.button.y, cellX, cellY)) {
+                    camera.centerOn(cellX, cellY);
+                    navigating = true;
+                }
+            }
+            if (e.type == SDL_MOUSEMOTION && navigating && !showOverview) {
+                const SDL_Rect map = worldRenderer->minimapRect();
+                const int clampedX = std::max(map.x, std::min(e.motion.x, map.x + map.w - 1));
+                const int clampedY = std::max(map.y, std::min(e.motion.y, map.y + map.h - 1));
+                int cellX, cellY;
+                if (worldRenderer->mapToWorld(map, clampedX, clampedY, cellX, cellY)) camera.centerOn(cellX, cellY);
+            }
+            if (e.type == SDL_MOUSEBUTTONUP && e.button.button == SDL_BUTTON_LEFT && navigating) {
+                navigating = false;
+                showOverview = false; // Goes back to the camera once a place in the overview was picked.
+            }
+
+            // Pans the camera while the middle mouse button is dragged.
+            if (e.type == SDL_MOUSEMOTION && (e.motion.state & SDL_BUTTON_MMASK)) {
+                panRemainder[0] -= e.motion.xrel;
+                panRemainder[1] -= e.motion.yrel;
+                camera.pan(panRemainder[0] / camera.zoom, panRemainder[1] / camera.zoom);
+                panRemainder[0] %= camera.zoom;
+                panRemainder[1] %= camera.zoom;
             }
 
             // Gets the mouse position and state.
@@ -70,8 +156,33 @@ int main(int argc, char* argv[]) {
                 else if (e.key.keysym.sym == SDLK_SPACE && !spacePressed) {
                     // Pauses or unpauses the simulation.
                     paused = !paused;
+                    simulationThread->setPaused(paused);
                     spacePressed = true;
                 }
+                // Cycles the heatmap through updates, moves and time per chunk, and off again.
+                else if (e.key.keysym.sym == SDLK_h) {
+                    heatmapMode = nextHeatmapMode(heatmapMode);
+                    simulationThread->setHeatmap(heatmapMode);
+                }
+                // Moves the camera with the arrow keys, zooms with plus and minus, and goes back to the start with home.
+                else if (e.key.keysym.sym == SDLK_LEFT) camera.pan(-std::max(1, Camera::PAN_STEP / camera.zoom), 0);
+                else if (e.key.keysym.sym == SDLK_RIGHT) camera.pan(std::max(1, Camera::PAN_STEP / camera.zoom), 0);
+                else if (e.key.keysym.sym == SDLK_UP) camera.pan(0, -std::max(1, Camera::PAN_STEP / camera.zoom));
+                else if (e.key.keysym.sym == SDLK_DOWN) camera.pan(0, std::max(1, Camera::PAN_STEP / camera.zoom));
+                else if (e.key.keysym.sym == SDLK_EQUALS || e.key.keysym.sym == SDLK_KP_PLUS) {
+                    camera.zoomAt(options.windowWidth / 2, options.windowHeight / 2, camera.zoom + 1);
+                }
+                else if (e.key.keysym.sym == SDLK_MINUS || e.key.keysym.sym == SDLK_KP_MINUS) {
+                    camera.zoomAt(options.windowWidth / 2, options.windowHeight / 2, camera.zoom - 1);
+                }
+                else if (e.key.keysym.sym == SDLK_HOME) camera.reset(options.particleSize);
+                // Turns turbo mode on or off, to let the world settle quickly.
+                else if (e.key.keysym.sym == SDLK_f) {
+                    turbo = !turbo;
+                    simulationThread->setTurbo(turbo);
+                }
+                // Shows or hides the overview of the whole world.
+                else if (e.key.keysym.sym == SDLK_o) showOverview = !showOverview;
             }
 
             if (e.type == SDL_KEYUP) {
@@ -87,157 +198,76 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        // Checks if the user is pressing any mouse buttons.
-        if (mouseState) {
-            interpolate(lastMouse[0], lastMouse[1], mouse[0], mouse[1]);
+        if (camera != lastCamera) simulationThread->setViewport(camera.visibleCells());
+
+        // Checks if the user is pressing the left or right mouse button, and queues the stroke for the simulation thread.
+        // The mouse positions are turned into cells through the camera.
+        // Nothing is painted while the mouse is used to move the camera, or while the overview is shown.
+        if (!navigating && !showOverview && (mouseState & (SDL_BUTTON_LMASK | SDL_BUTTON_RMASK))) {
+            BrushStroke stroke{};
+            camera.screenToWorld(lastMouse[0], lastMouse[1], stroke.x1, stroke.y1);
+            camera.screenToWorld(mouse[0], mouse[1], stroke.x2, stroke.y2);
+            stroke.radius = brushSize;
+            stroke.place = (mouseState & SDL_BUTTON_LMASK) != 0;
+            stroke.erase = (mouseState & SDL_BUTTON_RMASK) != 0;
+            stroke.typeIndex = currentParticleTypeIndex;
+            simulationThread->paint(stroke);
             lastMouse[0] = mouse[0];
             lastMouse[1] = mouse[1];
         }
 
-        // Clears the screen.
-        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-        SDL_RenderClear(renderer);
+        // Keeps the last frame on the screen if nothing happened while the simulation is idle.
+        if (simulationIdle && !changed) continue;
 
-        // Shuffles the indices.
-        std::shuffle(indices.begin(), indices.end(), g);
-
-        // Goes through every particle in the world in a random order and renders it.
-        for (const int i : indices) {
-            Particle* particle = worldParticleData[i];
-            if (particle != nullptr && particle->id != 0) {
-                if (!particle->updatedThisFrame) {
-                    if (!paused) { particle->update(); }
-                    particle->render(renderer, i % (WIDTH / PARTICLE_SIZE), i / (WIDTH / PARTICLE_SIZE));
-                }
-            }
+        // Uploads the cells that changed in the most recent image, and draws what the camera sees with the minimap on top,
+        // or the overview of the whole world.
+        if (newSnapshot) {
+            snapshot = newSnapshot;
+            stats = snapshot->stats;
         }
-
-        // Makes the color of the sand particles change slightly over time.
-        sandColorMask += 0.1f * static_cast<float>(sandColorSwitch);
-        if (sandColorMask >= 5.0f) {
-            sandColorSwitch = -1;
-        } else if (sandColorMask <= -15.0f) {
-            sandColorSwitch = 1;
+        // The heatmap is drawn over either of them, once the simulation has built one.
+        if (snapshot) {
+            worldRenderer->upload(snapshot->frame, camera);
+            worldRenderer->uploadOverview(snapshot->overview);
+            worldRenderer->uploadHeatmap(snapshot->heatmap);
+        }
+        const bool showHeatmap = heatmapMode != HeatmapMode::Off && snapshot && snapshot->heatmap.mode != HeatmapMode::Off;
+        if (showOverview) {
+            worldRenderer->drawOverview(camera, overlay);
+            if (showHeatmap) worldRenderer->drawHeatmap(worldRenderer->overviewRect());
+        } else {
+            worldRenderer->draw(camera);
+            if (showHeatmap) worldRenderer->drawHeatmap(worldRenderer->cameraRect(camera));
+            worldRenderer->drawMinimap(camera, overlay);
         }
 
-        // Goes through every particle in the world in a random order and updates it.
-        for (const int i : indices) {
-            Particle* particle = worldParticleData[i];
-            if (particle != nullptr && particle->id != 0) particle->updatedThisFrame = false;
+        // Shows the statistics in the window title, once every second.
+        if (startTime - lastTitleUpdate >= 1000) {
+            char statsText[448];
+            stats.format(statsText, sizeof(statsText));
+            snprintf(title, sizeof(title), "Falling Sand Simulation C++ | %s", statsText);
+            SDL_SetWindowTitle(window, title);
+            lastTitleUpdate = startTime;
         }
 
-        // Draws the circle that shows the brush size at the current mouse position.
-        drawCircle(renderer, mouse[0], mouse[1], brushSize * PARTICLE_SIZE);
+        // Queues the circle that shows the brush size at the current mouse position, and draws the whole overlay.
+        if (!showOverview) overlay.circle(mouse[0], mouse[1], brushSize * camera.zoom, SDL_Color{255, 255, 255, 255});
+        overlay.draw(renderer);
 
         // Displays the rendered pixel buffer to the screen.
-        SDL_RenderPresent(renderer);
-
-        // Gets the end time.
-        const Uint32 endTime = SDL_GetTicks();
+        worldRenderer->present();
 
-        // Calculates the frame time.
-        const Uint32 frameTime = endTime - startTime;
-
-        // Delays the program if the frame time is less than the target frame time.
-        if (frameTime < TARGET_FRAME_TIME) {
-            SDL_Delay(TARGET_FRAME_TIME - frameTime);
-        }
+        // Waits for the next frame, unless presenting already waited for the display, or the frame rate is uncapped.
+        if (!worldRenderer->vsync() && !uncapped) frameScheduler.wait();
     }
 
-    // Deallocates memory for worldParticleData.
-    delete[] worldParticleData;
-
-    // Frees memory and quits SDL.
+    // Stops the simulation thread, writes the frames that are still queued, frees memory and quits SDL.
+    simulationThread.reset();
+    exporter.reset();
+    worldRenderer.reset();
     SDL_DestroyWindow(window);
-    SDL_DestroyRenderer(renderer);
     SDL_Quit();
 
     // Exits the program.
     return EXIT_SUCCESS;
 }
-
-// Sets the color of a pixel at the specified position.
-void setPixel(SDL_Renderer* renderer, const int x, const int y, const SDL_Color color) {
-    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
-    SDL_RenderDrawPoint(renderer, x, y);
-}
-
-// Draws the outline of a circle at the specified position, with the specified radius.
-void drawCircle(SDL_Renderer* renderer, const int centerX, const int centerY, const int radius) {
-    int x = radius;
-    int y = 0;
-    int err = 0;
-
-    constexpr SDL_Color color = {255, 255, 255, 255};
-
-    while (x >= y) {
-        // Draw the eight octants of the circle.
-        setPixel(renderer, centerX + x, centerY + y, color);
-        setPixel(renderer, centerX + y, centerY + x, color);
-        setPixel(renderer, centerX - y, centerY + x, color);
-        setPixel(renderer, centerX - x, centerY + y, color);
-        setPixel(renderer, centerX - x, centerY - y, color);
-        setPixel(renderer, centerX - y, centerY - x, color);
-        setPixel(renderer, centerX + y, centerY - x, color);
-        setPixel(renderer, centerX + x, centerY - y, color);
-
-        if (err <= 0) {
-            y++;
-            err += 2*y + 1;
-        }
-
-        if (err > 0) {
-            x--;
-            err -= 2*x + 1;
-        }
-    }
-}
-
-// An interpolation function that relies on Bresenham's line algorithm.
-void interpolate(int x1, int y1, const int x2, const int y2) {
-    int dx = abs(x2 - x1);
-    int dy = abs(y2 - y1);
-    const int sx = (x1 < x2) ? 1 : -1;
-    const int sy = (y1 < y2) ? 1 : -1;
-    int err = dx - dy;
-
-    while (true) {
-        for (int i = -brushSize; i <= brushSize; i++) {
-            for (int j = -brushSize; j <= brushSize; j++) {
-                if (i * i + j * j <= brushSize * brushSize) {
-                    const int brushX = (x1 / PARTICLE_SIZE) + i;
-                    const int brushY = (y1 / PARTICLE_SIZE) + j;
-
-                    // Checks if the brush is within the bounds of the screen.
-                    if (brushX >= 0 && brushX < WIDTH / PARTICLE_SIZE && brushY >= 0 && brushY < HEIGHT / PARTICLE_SIZE) {
-                        const int index = brushY * (WIDTH / PARTICLE_SIZE) + brushX; // Calculates the index of the particle at the current position.
-                        if ((mouseState & SDL_BUTTON(SDL_BUTTON_LEFT)) && worldParticleData[index] == nullptr) { // If the user is left clicking.
-                            switch (particleTypes[currentParticleTypeIndex]) { // Creates a new particle at the current position based on the current particle type.
-                                case ParticleType::Sand:
-                                    worldParticleData[index] = new SandParticle(brushX, brushY);
-                                break;
-                                case ParticleType::Stone:
-                                    worldParticleData[index] = new StoneParticle(brushX, brushY);
-                                break;
-                                case ParticleType::Gunpowder:
-                                    worldParticleData[index] = new GunpowderParticle(brushX, brushY);
-                                break;
-                                case ParticleType::Fire:
-                                    worldParticleData[index] = new FireParticle(brushX, brushY);
-                                break;
-                            }
-                        }
-                        else if (mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT)) { // If the user is right clicking.
-                            worldParticleData[index] = nullptr; // Deletes the particle at the current position.
-                        }
-                    }
-                }
-            }
-        }
-
-        if (x1 == x2 && y1 == y2) break;
-        int e2 = 2 * err;
-        if (e2 > -dy) { err -= dy; x1 += sx; }
-        if (e2 < dx) { err += dx; y1 += sy; }
-    }
-}
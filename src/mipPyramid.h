@@ -0,0 +1,236 @@
+#ifndef MIP_PYRAMID_H
+#define MIP_PYRAMID_H
+
+#include <algorithm> // Includes the algorithm library for min and max.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <vector> // Includes the vector library for the levels and their pixels.
+#include "world.h" // Includes the world.h header file.
+#include "palette.h" // Includes the palette.h header file.
+
+// Smaller and smaller images of the whole world, where each pixel is the average color of the cells under it.
+// Used for the overview of the whole world and the minimap. Each level is half the size of the one before it,
+// and the first level is the largest one that still has to be scaled down to fit in the window.
+// Like the frame buffer, it is kept from one tick to the next, and only the parts of the world that changed are reduced again.
+// When the palette changes, only the chunks that hold a recolored particle are reduced again, and the reduction carries on where it was.
+class MipPyramid {
+public:
+    // The most cells reduced in a single update. Changes past that are kept for the next update, starting where this one stopped,
+    // so that a world where everything moves at once can't slow the simulation down. The images just catch up over a few ticks.
+    static constexpr uint64_t MAX_CELLS_PER_UPDATE = 1 << 18;
+
+    // A single image of the pyramid.
+    struct Level {
+        int shift; // Each pixel covers a block of 2^shift x 2^shift cells.
+        int width; // The width of the image, in pixels.
+        int height; // The height of the image, in pixels.
+        std::vector<uint32_t> pixels; // The pixels, row by row, from the top left corner.
+        DirtyRect unsent; // The pixels that changed since the image was last uploaded.
+
+        // The number of bytes between the start of two rows.
+        int pitch() const {
+            return width * static_cast<int>(sizeof(uint32_t));
+        }
+    };
+
+    std::vector<Level> levels; // From the largest image down to a single pixel.
+    uint64_t cellsReduced = 0; // The number of cells reduced since the images were last uploaded.
+
+    // Creates the images of a world of the given size. The first level is the largest one that fits in maxWidth x maxHeight pixels,
+    // and is always at least half the size of the world, as the world at full size is the frame buffer.
+    MipPyramid(const int worldWidth, const int worldHeight, const int maxWidth, const int maxHeight) : worldWidth(worldWidth), worldHeight(worldHeight) {
+        int shift = 1;
+        while ((reducedSize(worldWidth, shift) > maxWidth || reducedSize(worldHeight, shift) > maxHeight) &&
+            (reducedSize(worldWidth, shift) > 1 || reducedSize(worldHeight, shift) > 1)) shift++;
+
+        while (true) {
+            Level level;
+            level.shift = shift;
+            level.width = reducedSize(worldWidth, shift);
+            level.height = reducedSize(worldHeight, shift);
+            level.pixels.assign(static_cast<size_t>(level.width) * level.height, EMPTY_PIXEL);
+            level.unsent = DirtyRect{0, 0, level.width - 1, level.height - 1}; // Uploads the empty image before anything is reduced.
+            levels.push_back(std::move(level));
+            if (reducedSize(worldWidth, shift) == 1 && reducedSize(worldHeight, shift) == 1) break;
+            shift++;
+        }
+
+        sums.resize(static_cast<size_t>(levels[0].width) * 3);
+    }
+
+    // The largest level that fits in the given size, or the smallest one if none does.
+    const Level& levelFitting(const int maxWidth, const int maxHeight) const {
+        for (const Level& level : levels) {
+            if (level.width <= maxWidth && level.height <= maxHeight) return level;
+        }
+        return levels.back();
+    }
+
+    // Remembers the cells that changed in the world so far. Called at the same times as FrameBuffer::collectChanges().
+    void collectChanges(const World& world) {
+        if (damage.size() != world.chunks.size()) {
+            damage.assign(world.chunks.size(), DirtyRect{});
+            chunkIds.assign(world.chunks.size(), 0);
+            fullRedraw = true;
+        }
+
+        for (size_t i = 0; i < world.chunks.size(); i++) {
+            // Clips the changes to the world, as the cells next to a change can be past the edge of a chunk that is cut off.
+            const DirtyRect changed = world.chunks[i].nextDirty.load();
+            if (!changed.empty()) {
+                damage[i].include(std::max(changed.minX, 0), std::max(changed.minY, 0),
+                    std::min(changed.maxX, world.width - 1), std::min(changed.maxY, world.height - 1));
+            }
+        }
+    }
+
+    // Reduces the cells that changed since the last update into every level, chunk by chunk, until the given number of cells is used up.
+    void update(const World& world, const uint64_t maxCells = MAX_CELLS_PER_UPDATE) {
+        if (damage.size() != world.chunks.size()) collectChanges(world);
+
+        if (fullRedraw) {
+            for (size_t i = 0; i < damage.size(); i++) damage[i] = chunkBounds(world, i);
+            fullRedraw = false;
+        } else if (paletteVersion != palette.version) {
+            const uint64_t recolored = palette.idsChangedSince(paletteVersion);
+            for (size_t i = 0; i < damage.size(); i++) {
+                if (chunkIds[i] & recolored) damage[i] = chunkBounds(world, i);
+            }
+        }
+        paletteVersion = palette.version;
+
+        uint64_t budget = maxCells;
+        for (size_t checked = 0; checked < damage.size() && budget > 0; checked++) {
+            DirtyRect& rect = damage[cursor];
+            if (!rect.empty()) {
+                // A chunk that is reduced as a whole finds out which particles it holds from scratch, so that the IDs don't only ever grow.
+                const DirtyRect bounds = chunkBounds(world, cursor);
+                if (rect.minX == bounds.minX && rect.minY == bounds.minY && rect.maxX == bounds.maxX && rect.maxY == bounds.maxY) chunkIds[cursor] = 0;
+                const uint64_t cells = reduceArea(world, rect, chunkIds[cursor]);
+                cellsReduced += cells;
+                budget -= std::min(budget, cells);
+                rect = DirtyRect{};
+            }
+            cursor = (cursor + 1) % damage.size();
+        }
+    }
+
+    // Marks every level as uploaded.
+    void markUploaded() {
+        for (Level& level : levels) level.unsent = DirtyRect{};
+        cellsReduced = 0;
+    }
+
+private:
+    const int worldWidth; // The size of the world, in cells.
+    const int worldHeight;
+
+    std::vector<DirtyRect> damage; // The cells of each chunk that changed since they were last reduced.
+    std::vector<uint64_t> chunkIds; // The IDs of the particles read while reducing each chunk, one bit per ID. May include particles that left since.
+    size_t cursor = 0; // The chunk the next update starts at.
+    bool fullRedraw = true; // Whether the whole world has to be reduced again, like on the first update.
+    uint32_t paletteVersion = 0; // The version of the palette the images were reduced with.
+    std::vector<uint32_t> sums; // The red, green and blue sums of a row of pixels of the first level, kept so that it doesn't allocate.
+
+    // The size of a side of the world in a level, rounded up so that the cells at the edge get a pixel as well.
+    static int reducedSize(const int size, const int shift) {
+        return std::max(1, (size + (1 << shift) - 1) >> shift);
+    }
+
+    // The cells of the given chunk, cut off by the edges of the world.
+    DirtyRect chunkBounds(const World& world, const size_t i) const {
+        const int chunkX = static_cast<int>(i % world.chunksX), chunkY = static_cast<int>(i / world.chunksX);
+        return DirtyRect{chunkX * CHUNK_SIZE, chunkY * CHUNK_SIZE,
+            std::min((chunkX + 1) * CHUNK_SIZE, worldWidth) - 1, std::min((chunkY + 1) * CHUNK_SIZE, worldHeight) - 1};
+    }
+
+    // Reduces the given cells into the first level, and then every level into the next one, only where the pixels cover the cells.
+    // Adds the IDs of the particles read to ids. Returns the number of cells that were read.
+    uint64_t reduceArea(const World& world, const DirtyRect& area, uint64_t& ids) {
+        const Level& first = levels[0];
+        const int shift = first.shift;
+        int minX = area.minX >> shift, maxX = area.maxX >> shift;
+        int minY = area.minY >> shift, maxY = area.maxY >> shift;
+        const uint64_t cells = reduceCells(world, minX, minY, maxX, maxY, ids);
+
+        for (size_t i = 1; i < levels.size(); i++) {
+            minX >>= 1; maxX >>= 1;
+            minY >>= 1; maxY >>= 1;
+            reducePixels(levels[i - 1], levels[i], minX, minY, maxX, maxY);
+        }
+        return cells;
+    }
+
+    // Sets the given pixels of the first level to the average color of the cells under them, and adds the IDs of their particles to ids.
+    uint64_t reduceCells(const World& world, const int minX, const int minY, const int maxX, const int maxY, uint64_t& ids) {
+        Level& level = levels[0];
+        const int shift = level.shift;
+        const uint32_t* colors = palette.colors;
+        const int beginX = minX << shift, endX = std::min((maxX + 1) << shift, worldWidth);
+        const int columns = maxX - minX + 1;
+        uint64_t seen = 0; // The IDs read so far, kept in a register.
+
+        for (int y = minY; y <= maxY; y++) {
+            std::fill_n(sums.begin(), columns * 3, 0u);
+            const int beginY = y << shift, endY = std::min((y + 1) << shift, worldHeight);
+
+            // Adds up each row of a block with the red and blue channels packed into the halves of one word,
+            // which can't overflow for up to 256 cells, before adding the row to the sums of the pixel.
+            for (int cellY = beginY; cellY < endY; cellY++) {
+                const Cell* cell = &world.cells[static_cast<size_t>(cellY) * worldWidth];
+                uint32_t* sum = sums.data();
+                for (int x = minX; x <= maxX; x++, sum += 3) {
+                    const int blockEnd = std::min((x + 1) << shift, endX);
+                    for (int cellX = x << shift; cellX < blockEnd; cellX += 256) {
+                        const int end = std::min(cellX + 256, blockEnd);
+                        uint32_t redBlue = 0, green = 0;
+                        for (int i = cellX; i < end; i++) {
+                            const uint32_t color = colors[cell[i].material];
+                            seen |= uint64_t{1} << (cell[i].material & ID_MASK);
+                            redBlue += color & 0x00FF00FF;
+                            green += color & 0x0000FF00;
+                        }
+                        sum[0] += redBlue >> 16;
+                        sum[1] += green >> 8;
+                        sum[2] += redBlue & 0xFFFF;
+                    }
+                }
+            }
+
+            const int rows = endY - beginY;
+            uint32_t* pixel = &level.pixels[static_cast<size_t>(y) * level.width];
+            for (int x = minX; x <= maxX; x++) {
+                const uint32_t count = static_cast<uint32_t>((std::min((x + 1) << shift, worldWidth) - (x << shift)) * rows);
+                const uint32_t* sum = &sums[static_cast<size_t>(x - minX) * 3];
+                pixel[x] = 0xFF000000u | sum[0] / count << 16 | sum[1] / count << 8 | sum[2] / count;
+            }
+        }
+
+        ids |= seen;
+        level.unsent.include(minX, minY, maxX, maxY);
+        return static_cast<uint64_t>(endX - beginX) * (std::min((maxY + 1) << shift, worldHeight) - (minY << shift));
+    }
+
+    // Sets the given pixels of a level to the average color of the pixels under them in the level before it.
+    static void reducePixels(const Level& source, Level& level, const int minX, const int minY, const int maxX, const int maxY) {
+        for (int y = minY; y <= maxY; y++) {
+            const int sourceY = y * 2, rows = std::min(2, source.height - sourceY);
+            for (int x = minX; x <= maxX; x++) {
+                const int sourceX = x * 2, columns = std::min(2, source.width - sourceX);
+                uint32_t red = 0, green = 0, blue = 0;
+                for (int row = 0; row < rows; row++) {
+                    const uint32_t* pixel = &source.pixels[static_cast<size_t>(sourceY + row) * source.width + sourceX];
+                    for (int column = 0; column < columns; column++) {
+                        red += pixel[column] >> 16 & 0xFF;
+                        green += pixel[column] >> 8 & 0xFF;
+                        blue += pixel[column] & 0xFF;
+                    }
+                }
+                const uint32_t count = static_cast<uint32_t>(rows * columns);
+                level.pixels[static_cast<size_t>(y) * level.width + x] = 0xFF000000u | red / count << 16 | green / count << 8 | blue / count;
+            }
+        }
+        level.unsent.include(minX, minY, maxX, maxY);
+    }
+};
+
+#endif //MIP_PYRAMID_H
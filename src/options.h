@@ -0,0 +1,237 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cerrno> // Includes the cerrno library for detecting numbers that are out of range.
+#include <climits> // Includes the climits library for the range of int.
+#include <cstdio> // Includes the cstdio library for printing the usage.
+#include <cstdlib> // Includes the cstdlib library for parsing numbers.
+#include <cstring> // Includes the cstring library for comparing the option names.
+#include <fstream> // Includes the fstream library for reading config files.
+#include <sstream> // Includes the sstream library for splitting the lines of config files.
+#include <string> // Includes the string library for strings.
+#include <thread> // Includes the thread library for getting the number of cores.
+#include "globals.h"
+
+// Which kernels the simulation uses.
+enum class KernelMode {
+    Specialized, // Uses the kernels specialized for the size of the world, if it is one of the standard sizes.
+    Generic, // Always uses the generic kernels, which read the size of the world at runtime.
+    Compare // Runs the headless benchmark with both, and prints the speedup of the specialized kernels.
+};
+
+// Where the image of the world is scaled up to the size of the particles.
+enum class UpscaleMode {
+    Auto, // On the CPU if there is no GPU, otherwise on the GPU.
+    Gpu, // Stretched by the renderer when it is drawn.
+    Cpu // Scaled up by several threads before it is uploaded.
+};
+
+// How fast the window runs the simulation and shows frames.
+enum class PacingMode {
+    Fixed, // Ticks at the target tick rate, and shows frames at the rate of the display, or at the target frame rate without vsync.
+    Uncapped // Ticks and shows frames as fast as possible, for benchmarking.
+};
+
+// The file format frames are exported in.
+enum class ExportFormat {
+    Y4m, // A single YUV4MPEG2 video, which most video tools can read directly.
+    Ppm // A stream of binary PPM images, one after the other.
+};
+
+// The largest size of a cell in exported frames, in pixels. Enough to export a 480x270 world as an 8K video.
+constexpr int MAX_EXPORT_SCALE = 16;
+// The largest width or height of an exported frame, in pixels, and the most bytes a single frame can take.
+// Larger frames would need gigabytes for every frame, so they are refused up front instead of failing to allocate.
+constexpr size_t MAX_EXPORT_SIZE = 16384;
+constexpr size_t MAX_EXPORT_BYTES = size_t{512} << 20;
+
+// Checks if frames of a world of the given size, with every cell scale x scale pixels, are small enough to export.
+// Computed in size_t, so that large worlds or scales can't overflow.
+inline bool exportSizeValid(const int width, const int height, const int scale) {
+    if (width <= 0 || height <= 0 || scale <= 0) return false;
+    const size_t scaledWidth = static_cast<size_t>(width) * scale;
+    const size_t scaledHeight = static_cast<size_t>(height) * scale;
+    return scaledWidth <= MAX_EXPORT_SIZE && scaledHeight <= MAX_EXPORT_SIZE && scaledWidth * scaledHeight * 3 <= MAX_EXPORT_BYTES;
+}
+
+// The options of the program, picked at startup from the command line or a config file. The defaults come from the constants in globals.h.
+struct Options {
+    int windowWidth = WIDTH; // The width of the window, in pixels.
+    int windowHeight = HEIGHT; // The height of the window, in pixels.
+    int particleSize = PARTICLE_SIZE; // The size of each particle on the screen, in pixels.
+
+    int worldWidth = 0; // The width of the world, in cells. 0 makes the world fill the window.
+    int worldHeight = 0; // The height of the world, in cells. 0 makes the world fill the window.
+
+    int threads = SIMULATION_THREADS; // The number of threads used to update the world. 0 uses one thread per core.
+    uint64_t seed = SIMULATION_SEED; // The seed used for the simulation's random numbers. 0 picks a random seed at startup.
+    TraversalOrder order = TRAVERSAL_ORDER;
+    RandomMode randomMode = RANDOM_MODE;
+    KernelMode kernels = KernelMode::Specialized;
+    bool softwareRenderer = false; // Whether to always use SDL's software renderer, even if a GPU is available.
+    UpscaleMode upscale = UpscaleMode::Auto;
+    PacingMode pacing = PacingMode::Fixed;
+
+    std::string exportPath; // The file or pipe to export frames to. Empty if nothing is exported.
+    ExportFormat exportFormat = ExportFormat::Y4m;
+    int exportEvery = 1; // Exports one in this many ticks.
+    int exportScale = 1; // The size of each cell in the exported frames, in pixels.
+
+    int ticks = 1000; // The number of frames to simulate in a headless run.
+    double fill = 0.25; // The share of cells filled with random particles in a headless run, if no scene is given.
+    std::string scene; // The path of a text scene to load in a headless run, instead of the random fill.
+
+    // The size of the world, in cells, after filling in the defaults.
+    int resolvedWorldWidth() const {
+        return worldWidth > 0 ? worldWidth : windowWidth / particleSize;
+    }
+
+    int resolvedWorldHeight() const {
+        return worldHeight > 0 ? worldHeight : windowHeight / particleSize;
+    }
+
+    int resolvedThreads() const {
+        return threads > 0 ? threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    // Picks a random seed if none was given, so that the seed of every run is known and can be printed.
+    void resolveSeed() {
+        if (seed == 0) seed = static_cast<uint64_t>(rd()) << 32 | rd();
+    }
+};
+
+// The options of the program.
+inline Options options;
+
+// Parses a whole decimal number. Returns false if the value isn't a number, has anything after it, or doesn't fit in an int.
+inline bool parseInt(const char* value, int& result) {
+    char* end;
+    errno = 0;
+    const long number = strtol(value, &end, 10);
+    if (end == value || *end != '\0' || errno == ERANGE || number < INT_MIN || number > INT_MAX) return false;
+    result = static_cast<int>(number);
+    return true;
+}
+
+// Sets a single option from its name and value. Returns false if the name or value is invalid.
+inline bool parseOption(Options& options, const char* name, const char* value) {
+    if (strcmp(name, "--window-width") == 0) return parseInt(value, options.windowWidth);
+    else if (strcmp(name, "--window-height") == 0) return parseInt(value, options.windowHeight);
+    else if (strcmp(name, "--particle-size") == 0) return parseInt(value, options.particleSize);
+    else if (strcmp(name, "--world-width") == 0) return parseInt(value, options.worldWidth);
+    else if (strcmp(name, "--world-height") == 0) return parseInt(value, options.worldHeight);
+    else if (strcmp(name, "--threads") == 0) return parseInt(value, options.threads);
+    else if (strcmp(name, "--seed") == 0) options.seed = strtoull(value, nullptr, 10);
+    else if (strcmp(name, "--ticks") == 0) return parseInt(value, options.ticks);
+    else if (strcmp(name, "--fill") == 0) options.fill = atof(value);
+    else if (strcmp(name, "--scene") == 0) options.scene = value;
+    else if (strcmp(name, "--export") == 0) options.exportPath = value;
+    else if (strcmp(name, "--export-every") == 0) return parseInt(value, options.exportEvery);
+    else if (strcmp(name, "--export-scale") == 0) return parseInt(value, options.exportScale);
+    else if (strcmp(name, "--export-format") == 0) {
+        if (strcmp(value, "y4m") == 0) options.exportFormat = ExportFormat::Y4m;
+        else if (strcmp(value, "ppm") == 0) options.exportFormat = ExportFormat::Ppm;
+        else return false;
+    }
+    else if (strcmp(name, "--order") == 0) {
+        if (strcmp(value, "shuffled") == 0) options.order = TraversalOrder::Shuffled;
+        else if (strcmp(value, "rotating") == 0) options.order = TraversalOrder::RotatingPermutations;
+        else if (strcmp(value, "alternating") == 0) options.order = TraversalOrder::AlternatingRows;
+        else if (strcmp(value, "random-rows") == 0) options.order = TraversalOrder::RandomRows;
+        else return false;
+    }
+    else if (strcmp(name, "--random") == 0) {
+        if (strcmp(value, "streams") == 0) options.randomMode = RandomMode::Streams;
+        else if (strcmp(value, "counter") == 0) options.randomMode = RandomMode::Counter;
+        else return false;
+    }
+    else if (strcmp(name, "--renderer") == 0) {
+        if (strcmp(value, "auto") == 0) options.softwareRenderer = false;
+        else if (strcmp(value, "software") == 0) options.softwareRenderer = true;
+        else return false;
+    }
+    else if (strcmp(name, "--upscale") == 0) {
+        if (strcmp(value, "auto") == 0) options.upscale = UpscaleMode::Auto;
+        else if (strcmp(value, "gpu") == 0) options.upscale = UpscaleMode::Gpu;
+        else if (strcmp(value, "cpu") == 0) options.upscale = UpscaleMode::Cpu;
+        else return false;
+    }
+    else if (strcmp(name, "--pacing") == 0) {
+        if (strcmp(value, "fixed") == 0) options.pacing = PacingMode::Fixed;
+        else if (strcmp(value, "uncapped") == 0) options.pacing = PacingMode::Uncapped;
+        else return false;
+    }
+    else if (strcmp(name, "--kernels") == 0) {
+        if (strcmp(value, "specialized") == 0) options.kernels = KernelMode::Specialized;
+        else if (strcmp(value, "generic") == 0) options.kernels = KernelMode::Generic;
+        else if (strcmp(value, "compare") == 0) options.kernels = KernelMode::Compare;
+        else return false;
+    }
+    else return false;
+    return true;
+}
+
+// Reads options from a config file. Each line holds the name of an option without the dashes, followed by its value.
+// Empty lines and lines starting with '#' are ignored.
+inline bool parseConfig(Options& options, const char* path) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream words(line);
+        std::string name, value;
+        if (!(words >> name) || name[0] == '#') continue;
+        if (!(words >> value) || !parseOption(options, ("--" + name).c_str(), value.c_str())) return false;
+    }
+    return true;
+}
+
+// Parses the command line into the given options. Returns false if the command line is invalid.
+inline bool parseOptions(const int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) return false; // Every option takes a value.
+
+        const bool valid = strcmp(argv[i], "--config") == 0 ? parseConfig(options, argv[i + 1]) : parseOption(options, argv[i], argv[i + 1]);
+        if (!valid) return false;
+    }
+    // A world size of 0 fills the window, but the window still has to hold at least one cell.
+    const bool sizeValid = options.windowWidth > 0 && options.windowHeight > 0 && options.particleSize > 0 && options.worldWidth >= 0 &&
+        options.worldHeight >= 0 && options.resolvedWorldWidth() > 0 && options.resolvedWorldHeight() > 0;
+    const bool exportValid = options.exportEvery > 0 && options.exportScale > 0 && options.exportScale <= MAX_EXPORT_SCALE &&
+        (options.exportPath.empty() || exportSizeValid(options.resolvedWorldWidth(), options.resolvedWorldHeight(), options.exportScale));
+    return sizeValid && exportValid && options.threads >= 0 && options.ticks >= 0;
+}
+
+// Prints how to use the program.
+inline void printUsage(const char* program) {
+    printf("Usage: %s [options]\n", program);
+    printf("  --config <file>         Reads options from a file, one 'name value' pair per line. (e.g. 'world-width 8192')\n");
+    printf("  --window-width <n>      The width of the window, in pixels. (default: %d)\n", WIDTH);
+    printf("  --window-height <n>     The height of the window, in pixels. (default: %d)\n", HEIGHT);
+    printf("  --particle-size <n>     The size of each particle on the screen, in pixels. (default: %d)\n", PARTICLE_SIZE);
+    printf("  --world-width <n>       The width of the world, in cells. 0 fills the window. (default: 0)\n");
+    printf("  --world-height <n>      The height of the world, in cells. 0 fills the window. (default: 0)\n");
+    printf("  --threads <n>           The number of threads, 0 for one per core. (default: %d)\n", SIMULATION_THREADS);
+    printf("  --seed <n>              The seed of the simulation, 0 for a random one. (default: %llu)\n", static_cast<unsigned long long>(SIMULATION_SEED));
+    printf("  --order <name>          The traversal order: shuffled, rotating, alternating or random-rows.\n");
+    printf("  --random <name>         The random mode: streams or counter.\n");
+    printf("  --kernels <name>        The kernels to use: specialized or generic. The headless simulation also takes\n");
+    printf("                          compare, which runs both and prints the speedup of the specialized ones.\n");
+    printf("  --export <file>         Writes every exported tick to a file or a pipe.\n");
+    printf("  --export-format <name>  The format of the exported frames: y4m or ppm. (default: y4m)\n");
+    printf("  --export-every <n>      Exports one in this many ticks. (default: 1)\n");
+    printf("  --export-scale <n>      The size of each cell in the exported frames, from 1 to %d pixels. (default: 1)\n", MAX_EXPORT_SCALE);
+    printf("                          Frames can be up to %zux%zu pixels, and %zu MB.\n", MAX_EXPORT_SIZE, MAX_EXPORT_SIZE, MAX_EXPORT_BYTES >> 20);
+    printf("Window only:\n");
+    printf("  --renderer <name>       The renderer: auto uses the GPU if possible, software always uses the CPU. (default: auto)\n");
+    printf("  --upscale <name>        Where the image is scaled up: auto, gpu or cpu. auto picks cpu for the software renderer.\n");
+    printf("  --pacing <name>         fixed runs at %d ticks per second, uncapped runs and draws as fast as possible. (default: fixed)\n", TARGET_FPS);
+    printf("Headless only:\n");
+    printf("  --ticks <n>             The number of frames to simulate. (default: 1000)\n");
+    printf("  --fill <share>          The share of cells to fill with random particles. (default: 0.25)\n");
+    printf("  --scene <file>          Loads a text scene instead of the random fill. Each line is a row of cells, where\n");
+    printf("                          's' is sand, '#' is stone, 'g' is gunpowder, 'f' is fire and anything else is empty.\n");
+}
+
+#endif //OPTIONS_H
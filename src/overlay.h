@@ -0,0 +1,93 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <SDL.h> // Includes the SDL library for rendering graphics.
+#include <vector> // Includes the vector library for the queued shapes.
+
+// Everything drawn on top of the world, like the brush outline and the outlines on the minimap.
+// Shapes are queued during the frame, grouped by color, and drawn at the end with a single call per color and kind of shape,
+// instead of setting the draw color and drawing every point on its own.
+class Overlay {
+public:
+    // Queues the outline of a circle at the given position, with the given radius, in pixels.
+    // The points of the outline are worked out once per radius, and only moved to the position every frame.
+    void circle(const int centerX, const int centerY, const int radius, const SDL_Color color) {
+        const std::vector<SDL_Point>& offsets = circlePoints(radius);
+        std::vector<SDL_Point>& points = batchFor(color).points;
+        for (const SDL_Point& offset : offsets) points.push_back(SDL_Point{centerX + offset.x, centerY + offset.y});
+    }
+
+    // Queues the outline of a rectangle.
+    void rect(const SDL_Rect& rect, const SDL_Color color) {
+        batchFor(color).rects.push_back(rect);
+    }
+
+    // Draws everything queued since the last call, and empties the queue. The batches keep their memory, so this doesn't allocate once warmed up.
+    void draw(SDL_Renderer* renderer) {
+        for (Batch& batch : batches) {
+            if (batch.points.empty() && batch.rects.empty()) continue;
+            SDL_SetRenderDrawColor(renderer, batch.color.r, batch.color.g, batch.color.b, batch.color.a);
+            if (!batch.points.empty()) SDL_RenderDrawPoints(renderer, batch.points.data(), static_cast<int>(batch.points.size()));
+            if (!batch.rects.empty()) SDL_RenderDrawRects(renderer, batch.rects.data(), static_cast<int>(batch.rects.size()));
+            batch.points.clear();
+            batch.rects.clear();
+        }
+    }
+
+private:
+    // The shapes of a single color.
+    struct Batch {
+        SDL_Color color;
+        std::vector<SDL_Point> points;
+        std::vector<SDL_Rect> rects;
+    };
+
+    std::vector<Batch> batches; // One for every color used so far. Only a handful of colors are ever used, so they are searched in order.
+    std::vector<std::vector<SDL_Point>> circles; // The points of the outline of every circle drawn so far, around (0, 0), by radius.
+
+    Batch& batchFor(const SDL_Color color) {
+        for (Batch& batch : batches) {
+            if (batch.color.r == color.r && batch.color.g == color.g && batch.color.b == color.b && batch.color.a == color.a) return batch;
+        }
+        batches.push_back(Batch{color, {}, {}});
+        return batches.back();
+    }
+
+    // Gets the points of the outline of a circle with the given radius, working them out the first time.
+    // Uses the midpoint circle algorithm, mirroring one octant into the other seven.
+    const std::vector<SDL_Point>& circlePoints(const int radius) {
+        if (radius < 0) return circlePoints(0);
+        if (static_cast<size_t>(radius) >= circles.size()) circles.resize(radius + 1);
+        std::vector<SDL_Point>& points = circles[radius];
+        if (!points.empty()) return points;
+
+        int x = radius;
+        int y = 0;
+        int err = 0;
+
+        while (x >= y) {
+            // Adds the eight octants of the circle.
+            points.push_back(SDL_Point{x, y});
+            points.push_back(SDL_Point{y, x});
+            points.push_back(SDL_Point{-y, x});
+            points.push_back(SDL_Point{-x, y});
+            points.push_back(SDL_Point{-x, -y});
+            points.push_back(SDL_Point{-y, -x});
+            points.push_back(SDL_Point{y, -x});
+            points.push_back(SDL_Point{x, -y});
+
+            if (err <= 0) {
+                y++;
+                err += 2*y + 1;
+            }
+
+            if (err > 0) {
+                x--;
+                err -= 2*x + 1;
+            }
+        }
+        return points;
+    }
+};
+
+#endif //OVERLAY_H
@@ -0,0 +1,63 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include "world.h" // Includes the world.h header file.
+#include "particleRegistry.h" // Includes the particle registry, for the colors of the particles.
+
+// The color of empty cells.
+constexpr uint32_t EMPTY_PIXEL = 0xFF000000;
+
+// Packs a color into a single 32-bit ARGB pixel, the layout of SDL_PIXELFORMAT_ARGB8888.
+constexpr uint32_t packColor(const color_t color) {
+    return 0xFF000000u | static_cast<uint32_t>(color.r) << 16 | static_cast<uint32_t>(color.g) << 8 | color.b;
+}
+
+static_assert(ID_MASK < 64, "The particle IDs of recolored materials are stored as one bit per ID in a 64-bit word.");
+
+// The color of every material, as ready to use pixels. A cell's color is just a lookup of its material,
+// so cells don't have to store their colors, and effects that change the color of a whole particle type only have to update the palette.
+class Palette {
+public:
+    alignas(64) uint32_t colors[256]; // The pixel of every material. Materials that no particle uses are drawn as empty.
+    uint32_t version = 0; // Incremented every time the colors change, so that images built with the old colors can be drawn again.
+
+    Palette() {
+        for (uint32_t& color : colors) color = EMPTY_PIXEL;
+        rebuild();
+    }
+
+    // Gets the colors of all the particle types again. Only the materials whose color actually changed get the new version.
+    void rebuild() {
+        uint32_t newColors[256];
+        for (uint32_t& color : newColors) color = EMPTY_PIXEL;
+        ParticleRegistry::forEachShade([&newColors](const uint8_t material, const color_t color) { newColors[material] = packColor(color); });
+
+        bool changed = false;
+        for (int material = 0; material < 256; material++) {
+            if (newColors[material] == colors[material]) continue;
+            colors[material] = newColors[material];
+            materialVersions[material] = version + 1;
+            changed = true;
+        }
+        if (changed) version++;
+    }
+
+    // The IDs of the particles with a material that changed color after the given version, one bit per ID.
+    // Images built with that version only have to draw the cells holding those particles again.
+    uint64_t idsChangedSince(const uint32_t since) const {
+        uint64_t ids = 0;
+        for (int material = 0; material < 256; material++) {
+            if (materialVersions[material] > since) ids |= uint64_t{1} << (material & ID_MASK);
+        }
+        return ids;
+    }
+
+private:
+    uint32_t materialVersions[256]{}; // The version each material last changed color in.
+};
+
+// The palette used to draw the world. Only used by the thread that builds the images of the world.
+inline Palette palette;
+
+#endif //PALETTE_H
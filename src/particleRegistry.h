@@ -0,0 +1,88 @@
+#ifndef PARTICLEREGISTRY_H
+#define PARTICLEREGISTRY_H
+
+#include "world.h"
+#include "grid.h"
+
+// Includes all particle types.
+#include "sandParticle.h"
+#include "stoneParticle.h"
+#include "gunpowderParticle.h"
+#include "fireParticle.h"
+
+// A compile-time list of particle types. Generates the dispatch from a cell's id or a ParticleType to the rules of its particle type,
+// so that the rules can be inlined instead of going through virtual functions. Cells only store the id, while the rest of the program
+// picks particle types by their ParticleType.
+template <typename... Types>
+class ParticleList {
+public:
+    static constexpr size_t count = sizeof...(Types);
+
+    // All the particle types in the list, in order, and their ids.
+    static constexpr std::array<ParticleType, count> types = {Types::type...};
+    static constexpr std::array<uint8_t, count> ids = {Types::id...};
+
+    // Creates a new cell of the given particle type.
+    static Cell create(const ParticleType type, Random& rng) {
+        Cell cell{};
+        ((type == Types::type ? (cell = Types::create(rng), true) : false) || ...);
+        return cell;
+    }
+
+    // Creates a new cell of the particle type with the given text scene symbol. Returns an empty cell if no type uses the symbol.
+    static Cell fromSymbol(const char symbol, Random& rng) {
+        Cell cell{};
+        ((symbol == Types::symbol ? (cell = Types::create(rng), true) : false) || ...);
+        return cell;
+    }
+
+    // Runs the update function of the particle in the given cell.
+    template <typename Grid>
+    static void update(Grid& world, const int x, const int y, Random& rng) {
+        const uint8_t id = world.at(x, y).id();
+        ((id == Types::id ? (Types::update(world, x, y, rng), true) : false) || ...);
+    }
+
+    // Gets the color of the particle in the given cell. Used where a single color is needed, the frame builder uses the palette instead.
+    static color_t color(const Cell& cell) {
+        color_t color{};
+        ((cell.id() == Types::id ? (color = Types::color(cell.shade()), true) : false) || ...);
+        return color;
+    }
+
+    // Calls the given function with the material and color of every shade of every particle type. Used to build the palette.
+    template <typename Function>
+    static void forEachShade(Function&& function) {
+        (forEachShadeOf<Types>(function), ...);
+    }
+
+private:
+    // Checks that no two particle types in the list share an id or a ParticleType.
+    static constexpr bool unique() {
+        for (size_t i = 0; i < count; i++) {
+            for (size_t j = i + 1; j < count; j++) {
+                if (ids[i] == ids[j] || types[i] == types[j]) return false;
+            }
+        }
+        return true;
+    }
+    static_assert(unique(), "Every particle type needs its own id and ParticleType.");
+
+    template <typename Type, typename Function>
+    static void forEachShadeOf(Function& function) {
+        static_assert(Type::id != 0 && Type::id <= ID_MASK, "Particle IDs must fit in the ID bits of a material, and 0 is empty.");
+        static_assert(Type::shades <= SHADE_COUNT, "Particle types can't have more shades than fit in a material.");
+        for (int shade = 0; shade < Type::shades; shade++) {
+            function(makeMaterial(Type::id, shade), Type::color(shade));
+        }
+    }
+};
+
+// The list of all the particle types. To add a new particle type, give it an unused id and a ParticleType, and add it to this list.
+using ParticleRegistry = ParticleList<SandParticle, StoneParticle, GunpowderParticle, FireParticle>;
+
+// A list of all the particle types, as well as an index to cycle through it.
+constexpr auto particleTypes = ParticleRegistry::types;
+inline int currentParticleTypeIndex = 0;
+
+#endif //PARTICLEREGISTRY_H
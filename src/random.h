@@ -0,0 +1,155 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <atomic> // Includes the atomic library for handing out thread streams.
+#include <cstddef> // Includes the cstddef library for size_t.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <limits> // Includes the limits library for the range of the generator.
+
+// Mixes a 64-bit state into a well distributed 64-bit value, and advances the state. Used to turn a single seed into many unrelated ones.
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// A counter-based random number generator (Squares). Turns a counter into random bits without any state,
+// so the same counter and key always give the same bits, no matter in which order they are asked for.
+inline uint64_t squares64(const uint64_t counter, const uint64_t key) {
+    uint64_t x = counter * key;
+    const uint64_t y = x;
+    const uint64_t z = y + key;
+
+    x = x * x + y; x = (x >> 32) | (x << 32);
+    x = x * x + z; x = (x >> 32) | (x << 32);
+    x = x * x + y; x = (x >> 32) | (x << 32);
+    const uint64_t t = x = x * x + z; x = (x >> 32) | (x << 32);
+    return t ^ ((x * x + y) >> 32);
+}
+
+// A small and fast random number generator (xoshiro128**). Each chunk and thread has its own, so they never have to be shared.
+// Meets the requirements of a uniform random bit generator, so it can be used with the standard library as well.
+class Random {
+public:
+    using result_type = uint32_t;
+
+    Random() : Random(0) {}
+
+    explicit Random(uint64_t seed) {
+        this->seed(seed);
+    }
+
+    void seed(uint64_t seed) {
+        const uint64_t a = splitMix64(seed);
+        const uint64_t b = splitMix64(seed);
+        state[0] = static_cast<uint32_t>(a);
+        state[1] = static_cast<uint32_t>(a >> 32);
+        state[2] = static_cast<uint32_t>(b);
+        state[3] = static_cast<uint32_t>(b >> 32);
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    // Generates 32 random bits.
+    result_type operator()() {
+        const uint32_t result = rotateLeft(state[1] * 5, 7) * 9;
+        const uint32_t t = state[1] << 9;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotateLeft(state[3], 11);
+
+        return result;
+    }
+
+    // Generates a random number from 0 to n - 1. Uses a multiplication instead of a modulo, as it is a lot faster.
+    uint32_t below(const uint32_t n) {
+        return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * n) >> 32);
+    }
+
+    // Generates a random boolean.
+    bool coin() {
+        return (*this)() >> 31;
+    }
+
+    // Fills the given words with random bits, for kernels that need a coin flip for every cell.
+    void fillBits(uint64_t* words, const size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const uint64_t high = (*this)(); // Drawn first, as the order of the two calls in a single expression is unspecified.
+            words[i] = high << 32 | (*this)();
+        }
+    }
+
+private:
+    uint32_t state[4]{};
+
+    static uint32_t rotateLeft(const uint32_t x, const int k) {
+        return (x << k) | (x >> (32 - k));
+    }
+};
+
+// The random number service of the simulation. Every generator is derived from a single master seed, so that a run can be reproduced.
+class RandomService {
+public:
+    explicit RandomService(const uint64_t masterSeed = 0) {
+        seed(masterSeed);
+    }
+
+    void seed(const uint64_t seed) {
+        masterSeed = seed;
+        nextThreadStream.store(0, std::memory_order_relaxed);
+
+        // Derives the keys for the counter-based streams. Squares needs odd keys with well mixed bits.
+        uint64_t state = seed;
+        cellKey = splitMix64(state) | 1;
+        chunkKey = splitMix64(state) | 1;
+    }
+
+    uint64_t seed() const {
+        return masterSeed;
+    }
+
+    // Creates the generator for the given stream. The same seed and stream always give the same sequence of numbers.
+    Random stream(const uint64_t streamIndex) const {
+        uint64_t state = masterSeed ^ (streamIndex * 0xD1B54A32D192ED03ull);
+        return Random(splitMix64(state));
+    }
+
+    // Creates the generator for the given chunk.
+    Random chunkStream(const int chunkIndex) const {
+        return stream(CHUNK_STREAMS + static_cast<uint64_t>(chunkIndex));
+    }
+
+    // Creates the generator for a cell on the given frame, using the counter-based generator.
+    // The numbers only depend on the seed, the frame and the cell, not on which thread or in which order the cells are updated.
+    Random cellCounterStream(const uint64_t frame, const int cellIndex) const {
+        return Random(squares64(frame << 32 | static_cast<uint32_t>(cellIndex), cellKey));
+    }
+
+    // Creates the generator for a chunk on the given frame, using the counter-based generator.
+    Random chunkCounterStream(const uint64_t frame, const int chunkIndex) const {
+        return Random(squares64(frame << 32 | static_cast<uint32_t>(chunkIndex), chunkKey));
+    }
+
+    // Creates a generator for a new thread. Each call gives a different stream.
+    Random threadStream() {
+        return stream(THREAD_STREAMS + nextThreadStream.fetch_add(1, std::memory_order_relaxed));
+    }
+
+private:
+    // Where the different kinds of streams start, so that they never overlap.
+    static constexpr uint64_t CHUNK_STREAMS = 1ull << 32;
+    static constexpr uint64_t THREAD_STREAMS = 2ull << 32;
+
+    uint64_t masterSeed = 0;
+    uint64_t cellKey = 1; // The key of the counter-based generator used for cells.
+    uint64_t chunkKey = 1; // The key of the counter-based generator used for chunks.
+    std::atomic<uint64_t> nextThreadStream{0};
+};
+
+#endif //RANDOM_H
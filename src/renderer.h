@@ -0,0 +1,274 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <SDL.h> // Includes the SDL library for rendering graphics.
+#include <memory> // Includes the memory library for unique_ptr.
+#include "options.h" // Includes the options.h header file.
+#include "frameBuffer.h" // Includes the frameBuffer.h header file.
+#include "scaledFrame.h" // Includes the scaledFrame.h header file.
+#include "mipPyramid.h" // Includes the mipPyramid.h header file.
+#include "camera.h" // Includes the camera.h header file.
+#include "overlay.h" // Includes the overlay.h header file.
+#include "activityMap.h" // Includes the activityMap.h header file.
+#include "threadPool.h" // Includes the threadPool.h header file.
+
+// Draws the world to the window. The frame buffer is uploaded to a streaming texture once per frame,
+// and the part of it that the camera sees is stretched over the window with a single copy, instead of drawing every particle on its own.
+// The image can also be scaled up on the CPU instead, by several threads at once, for renderers that are slow at scaling.
+// The overview of the whole world and the minimap are drawn from the smaller images of the mip pyramid, which have textures of their own.
+// The heatmap has a texture of its own as well, with a pixel per chunk, blended over the world.
+class Renderer {
+public:
+    static constexpr int MINIMAP_SIZE = 256; // The largest the minimap can be on each side, in pixels.
+    static constexpr int MINIMAP_MARGIN = 8; // The space between the minimap and the edges of the window, in pixels.
+
+    // Creates the renderer for the given window. Uses the GPU if possible, and falls back to SDL's software renderer otherwise.
+    // With vsync, presenting a frame waits for the display.
+    Renderer(SDL_Window* window, const int worldWidth, const int worldHeight, const int windowWidth, const int windowHeight,
+        const bool software, const bool vsync, const UpscaleMode upscale, const int threads)
+        : worldWidth(worldWidth), worldHeight(worldHeight), windowWidth(windowWidth), windowHeight(windowHeight), scaledCamera(0, 0, 0, 0, 1) {
+        if (!software) renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
+        if (!renderer) renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+        if (!renderer) return;
+
+        // Scales on the CPU if asked to, or by default if there is no GPU. Also if the world doesn't fit in a texture,
+        // as the CPU only needs a texture the size of the window.
+        SDL_RendererInfo info;
+        SDL_GetRendererInfo(renderer, &info);
+        synced = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+        const bool fits = (info.max_texture_width == 0 || worldWidth <= info.max_texture_width) &&
+            (info.max_texture_height == 0 || worldHeight <= info.max_texture_height);
+        const bool cpu = !fits || upscale == UpscaleMode::Cpu || (upscale == UpscaleMode::Auto && (info.flags & SDL_RENDERER_SOFTWARE));
+
+        if (cpu) {
+            scaled = std::make_unique<ScaledFrame>(windowWidth, windowHeight);
+            pool = std::make_unique<ThreadPool>(threads);
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, windowWidth, windowHeight);
+        } else {
+            texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, worldWidth, worldHeight);
+            if (texture) SDL_SetTextureScaleMode(texture, SDL_ScaleModeNearest); // Keeps the particles as sharp squares when scaled up.
+        }
+    }
+
+    ~Renderer() {
+        if (heatmapTexture) SDL_DestroyTexture(heatmapTexture);
+        if (overviewTexture) SDL_DestroyTexture(overviewTexture);
+        if (minimapTexture) SDL_DestroyTexture(minimapTexture);
+        if (texture) SDL_DestroyTexture(texture);
+        if (renderer) SDL_DestroyRenderer(renderer);
+    }
+
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    // Checks if the renderer and its texture were created successfully.
+    bool valid() const {
+        return renderer && texture;
+    }
+
+    SDL_Renderer* sdl() const {
+        return renderer;
+    }
+
+    // Checks if presenting a frame waits for the display, so the frames don't have to be paced by hand.
+    bool vsync() const {
+        return synced;
+    }
+
+    // Checks if the image is scaled up on the CPU.
+    bool scalesOnCpu() const {
+        return scaled != nullptr;
+    }
+
+    // Uploads the regions of the frame buffer that were drawn again to the texture, and marks them as uploaded.
+    // The rest of the texture keeps the previous frame. On the CPU, only what the camera sees is scaled up,
+    // and everything it sees is scaled up again when it moves.
+    void upload(FrameBuffer& frame, const Camera& camera) {
+        if (scaled) {
+            if (!scaledValid || camera != scaledCamera) {
+                scaled->upscaleVisible(frame, camera, *pool);
+                SDL_UpdateTexture(texture, nullptr, scaled->pixels.data(), scaled->pitch());
+                scaledCamera = camera;
+                scaledValid = true;
+            } else {
+                scaled->upscale(frame, frame.regions, camera, *pool);
+                for (const DirtyRect& region : frame.regions) {
+                    SDL_Rect rect;
+                    scaled->toPixels(region, camera, rect.x, rect.y, rect.w, rect.h);
+                    if (rect.w <= 0 || rect.h <= 0) continue;
+                    SDL_UpdateTexture(texture, &rect, &scaled->pixels[static_cast<size_t>(rect.y) * scaled->width + rect.x], scaled->pitch());
+                }
+            }
+        } else {
+            for (const DirtyRect& region : frame.regions) {
+                const SDL_Rect rect = {region.minX, region.minY, region.maxX - region.minX + 1, region.maxY - region.minY + 1};
+                SDL_UpdateTexture(texture, &rect, &frame.pixels[static_cast<size_t>(region.minY) * frame.width + region.minX], frame.pitch());
+            }
+        }
+        frame.markUploaded();
+    }
+
+    // Uploads the parts of the overview and the minimap that changed, and marks the whole pyramid as uploaded.
+    // The textures are created on the first upload, once the size of the levels is known.
+    void uploadOverview(MipPyramid& overview) {
+        const MipPyramid::Level& large = overview.levels[0];
+        const MipPyramid::Level& small = overview.levelFitting(MINIMAP_SIZE, MINIMAP_SIZE);
+        uploadLevel(large, overviewTexture);
+        uploadLevel(small, minimapTexture);
+        minimapWidth = small.width;
+        minimapHeight = small.height;
+        overview.markUploaded();
+    }
+
+    // Uploads the heatmap, if it was built. The whole image is uploaded every time, as it only has a pixel per chunk.
+    // The texture is created on the first upload.
+    void uploadHeatmap(const Heatmap& heatmap) {
+        if (heatmap.mode == HeatmapMode::Off) return;
+        if (!heatmapTexture) {
+            heatmapTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, heatmap.width, heatmap.height);
+            if (!heatmapTexture) return;
+            SDL_SetTextureBlendMode(heatmapTexture, SDL_BLENDMODE_BLEND); // Quiet chunks are transparent, so the world shows through.
+            SDL_SetTextureScaleMode(heatmapTexture, SDL_ScaleModeNearest); // Keeps the chunks as sharp squares when scaled up.
+            heatmapWidth = heatmap.width;
+            heatmapHeight = heatmap.height;
+        }
+        SDL_UpdateTexture(heatmapTexture, nullptr, heatmap.pixels.data(), heatmap.pitch());
+    }
+
+    // Clears the screen and draws what the camera sees of the texture over the window.
+    void draw(const Camera& camera) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+
+        if (scaled) {
+            SDL_RenderCopy(renderer, texture, nullptr, nullptr);
+            return;
+        }
+
+        const DirtyRect visible = camera.visibleCells();
+        const SDL_Rect source = {visible.minX, visible.minY, visible.maxX - visible.minX + 1, visible.maxY - visible.minY + 1};
+        const SDL_Rect destination = {0, 0, source.w * camera.zoom, source.h * camera.zoom};
+        SDL_RenderCopy(renderer, texture, &source, &destination);
+    }
+
+    // Draws the minimap in the top right corner of the window. Its border and the outline of the part of the world
+    // the camera sees are queued on the overlay.
+    void drawMinimap(const Camera& camera, Overlay& overlay) {
+        if (!minimapTexture) return;
+        const SDL_Rect rect = minimapRect();
+        SDL_RenderCopy(renderer, minimapTexture, nullptr, &rect);
+
+        overlay.rect(SDL_Rect{rect.x - 1, rect.y - 1, rect.w + 2, rect.h + 2}, SDL_Color{128, 128, 128, 255});
+        outlineCamera(rect, camera, overlay);
+    }
+
+    // Clears the screen and draws the whole world scaled down to fit in the window.
+    // The outline of the part of the world the camera sees is queued on the overlay.
+    void drawOverview(const Camera& camera, Overlay& overlay) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        if (!overviewTexture) return;
+        const SDL_Rect rect = overviewRect();
+        SDL_RenderCopy(renderer, overviewTexture, nullptr, &rect);
+        outlineCamera(rect, camera, overlay);
+    }
+
+    // Draws the last uploaded heatmap over the world, for a world drawn in the given rectangle.
+    // Chunks that are cut off by the edge of the world are cut off on the heatmap as well.
+    void drawHeatmap(const SDL_Rect& map) {
+        if (!heatmapTexture) return;
+        const SDL_Rect window = {0, 0, windowWidth, windowHeight};
+        SDL_Rect clip;
+        if (!SDL_IntersectRect(&map, &window, &clip)) return;
+
+        const SDL_Rect destination = {map.x, map.y,
+            static_cast<int>(static_cast<int64_t>(heatmapWidth) * CHUNK_SIZE * map.w / worldWidth),
+            static_cast<int>(static_cast<int64_t>(heatmapHeight) * CHUNK_SIZE * map.h / worldHeight)};
+        SDL_RenderSetClipRect(renderer, &clip);
+        SDL_RenderCopy(renderer, heatmapTexture, nullptr, &destination);
+        SDL_RenderSetClipRect(renderer, nullptr);
+    }
+
+    // Where the whole world is drawn in the window by the camera. Usually reaches far past the edges of the window.
+    SDL_Rect cameraRect(const Camera& camera) const {
+        return SDL_Rect{-camera.x * camera.zoom, -camera.y * camera.zoom, worldWidth * camera.zoom, worldHeight * camera.zoom};
+    }
+
+    // Where the minimap is drawn in the window.
+    SDL_Rect minimapRect() const {
+        return SDL_Rect{windowWidth - minimapWidth - MINIMAP_MARGIN, MINIMAP_MARGIN, minimapWidth, minimapHeight};
+    }
+
+    // Where the overview is drawn in the window. As large as possible while keeping the shape of the world, and centered.
+    SDL_Rect overviewRect() const {
+        const double scale = std::min(static_cast<double>(windowWidth) / worldWidth, static_cast<double>(windowHeight) / worldHeight);
+        const int w = std::max(1, static_cast<int>(worldWidth * scale));
+        const int h = std::max(1, static_cast<int>(worldHeight * scale));
+        return SDL_Rect{(windowWidth - w) / 2, (windowHeight - h) / 2, w, h};
+    }
+
+    // Converts a position in the window to the cell under it, for a map of the whole world drawn in the given rectangle.
+    // Returns false if the position is outside of the map.
+    bool mapToWorld(const SDL_Rect& map, const int screenX, const int screenY, int& cellX, int& cellY) const {
+        if (screenX < map.x || screenY < map.y || screenX >= map.x + map.w || screenY >= map.y + map.h) return false;
+        cellX = static_cast<int>(static_cast<int64_t>(screenX - map.x) * worldWidth / map.w);
+        cellY = static_cast<int>(static_cast<int64_t>(screenY - map.y) * worldHeight / map.h);
+        return true;
+    }
+
+    // Shows everything drawn this frame.
+    void present() {
+        SDL_RenderPresent(renderer);
+    }
+
+private:
+    const int worldWidth; // The size of the world, in cells.
+    const int worldHeight;
+    const int windowWidth; // The size of the window, in pixels.
+    const int windowHeight;
+
+    SDL_Renderer* renderer = nullptr;
+    bool synced = false; // Whether the renderer got vsync.
+    SDL_Texture* texture = nullptr; // The world with one pixel per cell, or what the camera sees at full size if it is scaled on the CPU.
+
+    std::unique_ptr<ScaledFrame> scaled; // The image scaled up on the CPU, if the GPU doesn't scale it.
+    std::unique_ptr<ThreadPool> pool; // The threads that scale the image up.
+    Camera scaledCamera; // The camera the scaled image was made with.
+    bool scaledValid = false; // Whether anything was scaled up yet.
+
+    SDL_Texture* overviewTexture = nullptr; // The largest level of the mip pyramid, for the overview.
+    SDL_Texture* minimapTexture = nullptr; // The largest level of the mip pyramid that fits in the minimap.
+    int minimapWidth = 0; // The size of the minimap, in pixels.
+    int minimapHeight = 0;
+
+    SDL_Texture* heatmapTexture = nullptr; // How active every chunk is, with a pixel per chunk.
+    int heatmapWidth = 0; // The size of the heatmap, in chunks.
+    int heatmapHeight = 0;
+
+    // Uploads the pixels of a level that changed to its texture, creating the texture first if needed.
+    void uploadLevel(const MipPyramid::Level& level, SDL_Texture*& levelTexture) {
+        if (!levelTexture) {
+            levelTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, level.width, level.height);
+            if (!levelTexture) return;
+            SDL_SetTextureScaleMode(levelTexture, SDL_ScaleModeLinear); // Blends the pixels when the overview is stretched, as they are already averages.
+        }
+        if (level.unsent.empty()) return;
+
+        const DirtyRect& region = level.unsent;
+        const SDL_Rect rect = {region.minX, region.minY, region.maxX - region.minX + 1, region.maxY - region.minY + 1};
+        SDL_UpdateTexture(levelTexture, &rect, &level.pixels[static_cast<size_t>(region.minY) * level.width + region.minX], level.pitch());
+    }
+
+    // Outlines the part of the world the camera sees, on a map of the whole world drawn in the given rectangle.
+    void outlineCamera(const SDL_Rect& map, const Camera& camera, Overlay& overlay) const {
+        const DirtyRect visible = camera.visibleCells();
+        if (visible.empty()) return;
+        const int minX = map.x + static_cast<int>(static_cast<int64_t>(visible.minX) * map.w / worldWidth);
+        const int minY = map.y + static_cast<int>(static_cast<int64_t>(visible.minY) * map.h / worldHeight);
+        const int maxX = map.x + static_cast<int>(static_cast<int64_t>(visible.maxX + 1) * map.w / worldWidth);
+        const int maxY = map.y + static_cast<int>(static_cast<int64_t>(visible.maxY + 1) * map.h / worldHeight);
+        overlay.rect(SDL_Rect{minX, minY, std::max(1, maxX - minX), std::max(1, maxY - minY)}, SDL_Color{255, 255, 255, 255});
+    }
+};
+
+#endif //RENDERER_H
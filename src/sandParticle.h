@@ -1,92 +1,89 @@
 #ifndef SANDPARTICLE_H
 #define SANDPARTICLE_H
 
-#include "globals.h"
+#include "world.h"
 
-// The sand particle class. Inherits from the particle class.
-class SandParticle : public Particle {
+// The rules for the sand particle. Operates on the cells of the world.
+class SandParticle {
 public:
-    SandParticle(const int x, const int y) {
-        id = 1;
-        position = {x, y};
-        velocity = {};
+    static constexpr uint8_t id = 1;
+    static constexpr ParticleType type = ParticleType::Sand;
+    static constexpr char symbol = 's'; // The character used for this particle in text scenes.
+    static constexpr int shades = 3; // The number of colors this particle can have.
 
-        color_t newSandColor = sandColor[rand() % 3];
+    static Cell create(Random& rng) {
+        return Cell{makeMaterial(id, rng.below(3)), {0, 0}, 0};
+    }
 
-        newSandColor.r += static_cast<uint8_t>(sandColorMask);
-        newSandColor.g += static_cast<uint8_t>(sandColorMask);
-        newSandColor.b += static_cast<uint8_t>(sandColorMask);
+    // Gets the color of the given shade. The current color mask is added to it, so the palette has to be rebuilt when the mask changes.
+    static color_t color(const int shade) {
+        color_t newSandColor = sandColor[shade];
 
-        color = newSandColor;
-    }
+        const int mask = static_cast<int>(sandColorMask);
+        newSandColor.r += static_cast<uint8_t>(mask);
+        newSandColor.g += static_cast<uint8_t>(mask);
+        newSandColor.b += static_cast<uint8_t>(mask);
 
-    std::default_random_engine eng{rd()}; // A random engine used to generate random numbers.
+        return newSandColor;
+    }
 
-    void update() override {
-        int x = this->position[0];
-        int y = this->position[1];
+    // Updates the particle. Works on the world itself, as well as on any view of it with the same functions.
+    template <typename Grid>
+    static void update(Grid& world, int x, int y, Random& rng) {
+        Cell& cell = world.at(x, y);
 
         // Applies gravity to the y-component of the velocity.
-        this->velocity[1] += GRAVITY / 50.0f; // Divides by 50 to make the gravity effect weaker.
+        addVelocity(cell.velocity[1], GRAVITY_STEP);
+        world.markUpdated(cell); // Stamps the particle with the current frame, so that it is not updated again this frame.
 
         // Calculates the new position based on the velocity.
-        const int newX = x + static_cast<int>(this->velocity[0]);
-        const int newY = y + static_cast<int>(this->velocity[1]);
+        const int newX = x + cell.velocity[0] / VELOCITY_SCALE;
+        const int newY = y + cell.velocity[1] / VELOCITY_SCALE;
 
         // Determines the direction of movement.
         const int dx = (newX > x) ? 1 : (newX < x) ? -1 : 0;
         const int dy = (newY > y) ? 1 : (newY < y) ? -1 : 0;
 
         // Moves the particle one step at a time towards the new position.
-        while (x != newX || y != newY) {
-            if (x != newX) {
-                x += dx;
+        int currentX = x;
+        int currentY = y;
+        while (currentX != newX || currentY != newY) {
+            if (currentX != newX) {
+                currentX += dx;
             }
-            if (y != newY) {
-                y += dy;
+            if (currentY != newY) {
+                currentY += dy;
             }
 
             // Checks if the new position is within the bounds and empty.
-            if (x >= 0 && x < WIDTH / PARTICLE_SIZE && y < HEIGHT / PARTICLE_SIZE && worldParticleData[y * (WIDTH / PARTICLE_SIZE) + x] == nullptr) {
+            if (world.isEmpty(currentX, currentY)) {
                 // Moves the particle to the new position.
-                worldParticleData[this->position[1] * (WIDTH / PARTICLE_SIZE) + this->position[0]] = nullptr;
-                worldParticleData[y * (WIDTH / PARTICLE_SIZE) + x] = this;
-                this->position[0] = x;
-                this->position[1] = y;
+                world.move(x, y, currentX, currentY);
+                x = currentX;
+                y = currentY;
             } else {
                 // Reset the velocity if the new position is not valid.
-                this->velocity[0] = 0;
-                this->velocity[1] = 0;
+                Cell& moved = world.at(x, y);
+                moved.velocity[0] = 0;
+                moved.velocity[1] = 0;
                 break;
             }
         }
 
         // The x-directions to check for empty spaces around the particle. (down, down-left, down-right)
-        std::array<int, 3> directions = {-1, 0, 1};
-        std::shuffle(directions.begin(), directions.end(), eng); // Shuffles the directions array.
+        const std::array<int, 3>& directions = DIRECTION_ORDERS[rng.below(6)]; // Picks the directions in a random order.
 
         // Loops through the directions array and checks if there is an empty space below the particle.
-        for (const int dx : directions) {
-            const int belowX = this->position[0] + dx;
-            const int belowY = this->position[1] + 1;
-            if (belowX >= 0 && belowX < WIDTH / PARTICLE_SIZE && belowY < HEIGHT / PARTICLE_SIZE && worldParticleData[belowY * (WIDTH / PARTICLE_SIZE) + belowX] == nullptr) {
+        for (const int direction : directions) {
+            const int belowX = x + direction;
+            const int belowY = y + 1;
+            if (world.isEmpty(belowX, belowY)) {
                 // Moves the particle to the empty space.
-                worldParticleData[this->position[1] * (WIDTH / PARTICLE_SIZE) + this->position[0]] = nullptr;
-                worldParticleData[belowY * (WIDTH / PARTICLE_SIZE) + belowX] = this;
-                this->position[0] = belowX;
-                this->position[1] = belowY;
+                if (direction != 0) world.countDiagonalMove(x, y, direction);
+                world.move(x, y, belowX, belowY);
                 break;
             }
         }
-
-        updatedThisFrame = true; // Sets the updatedThisFrame variable to true, so that the particle is not updated again this frame.
-    }
-
-    void render(SDL_Renderer* renderer, const int x, const int y) override {
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
-
-        const SDL_Rect rect = {x * PARTICLE_SIZE, y * PARTICLE_SIZE, PARTICLE_SIZE, PARTICLE_SIZE};
-        SDL_RenderFillRect(renderer, &rect);
     }
 };
 
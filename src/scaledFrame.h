@@ -0,0 +1,101 @@
+#ifndef SCALED_FRAME_H
+#define SCALED_FRAME_H
+
+#include <algorithm> // Includes the algorithm library for min, max and fill.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <cstring> // Includes the cstring library for copying rows.
+#include <vector> // Includes the vector library for the pixels.
+#include "frameBuffer.h" // Includes the frameBuffer.h header file.
+#include "camera.h" // Includes the camera.h header file.
+#include "threadPool.h" // Includes the threadPool.h header file.
+
+// An image of what a camera sees of the world at full resolution, where every cell is a block of zoom x zoom pixels.
+// Scaled up from a frame buffer on the CPU, split into horizontal stripes that are built in parallel.
+// Used by the renderer when the GPU can't scale the image itself, with the size of the window, and by the frame exporter
+// to write scaled up frames, with the size of the whole world times the export scale.
+class ScaledFrame {
+public:
+    const int width; // The width of the image, in pixels.
+    const int height; // The height of the image, in pixels.
+    std::vector<uint32_t> pixels; // The pixels, row by row, from the top left corner.
+
+    ScaledFrame(const int width, const int height) : width(width), height(height), pixels(static_cast<size_t>(width) * height, EMPTY_PIXEL) {}
+
+    // The number of bytes between the start of two rows.
+    int pitch() const {
+        return width * static_cast<int>(sizeof(uint32_t));
+    }
+
+    // Scales the visible parts of the given regions of the source up into the image. The regions are in cells.
+    // The visible rows are split into stripes of whole cells, one job each, so that every thread writes to its own rows.
+    void upscale(const FrameBuffer& source, const std::vector<DirtyRect>& regions, const Camera& camera, ThreadPool& pool) {
+        const DirtyRect visible = camera.visibleCells();
+        if (regions.empty() || visible.empty()) return;
+
+        const int rows = visible.maxY - visible.minY + 1;
+        const int stripes = std::min(rows, pool.size() * STRIPES_PER_THREAD);
+        pool.run(stripes, [&](const int stripe) {
+            const int beginRow = visible.minY + static_cast<int>(static_cast<int64_t>(rows) * stripe / stripes);
+            const int endRow = visible.minY + static_cast<int>(static_cast<int64_t>(rows) * (stripe + 1) / stripes);
+            for (const DirtyRect& region : regions) {
+                upscaleRows(source, camera, std::max(region.minX, visible.minX), std::min(region.maxX, visible.maxX) + 1,
+                    std::max(region.minY, beginRow), std::min(region.maxY + 1, endRow));
+            }
+        });
+    }
+
+    // Scales everything the camera sees up into the image. The parts of the image outside the world are left empty.
+    void upscaleVisible(const FrameBuffer& source, const Camera& camera, ThreadPool& pool) {
+        std::fill(pixels.begin(), pixels.end(), EMPTY_PIXEL);
+        wholeView.assign(1, camera.visibleCells());
+        upscale(source, wholeView, camera, pool);
+    }
+
+    // The part of the image covered by the given cells, in pixels. Cut off at the edges of the image.
+    void toPixels(const DirtyRect& cells, const Camera& camera, int& x, int& y, int& w, int& h) const {
+        x = std::max(0, (cells.minX - camera.x) * camera.zoom);
+        y = std::max(0, (cells.minY - camera.y) * camera.zoom);
+        w = std::min(width, (cells.maxX + 1 - camera.x) * camera.zoom) - x;
+        h = std::min(height, (cells.maxY + 1 - camera.y) * camera.zoom) - y;
+    }
+
+private:
+    static constexpr int STRIPES_PER_THREAD = 4; // More stripes than threads, so that a slow thread doesn't hold up the others.
+
+    std::vector<DirtyRect> wholeView; // The single region used by upscaleVisible(), kept so that it doesn't allocate every frame.
+
+    // Scales the cells from beginX to endX in the source rows from beginY to endY up into the image.
+    // Each source row is widened once, and then copied into the other rows of its block. Blocks at the edges of the image are cut off.
+    void upscaleRows(const FrameBuffer& source, const Camera& camera, const int beginX, const int endX, const int beginY, const int endY) {
+        if (beginX >= endX) return;
+
+        const int zoom = camera.zoom;
+        const int firstX = (beginX - camera.x) * zoom;
+        const int lastX = std::min((endX - camera.x) * zoom, width);
+        const size_t rowBytes = static_cast<size_t>(lastX - firstX) * sizeof(uint32_t);
+
+        for (int y = beginY; y < endY; y++) {
+            const int firstY = (y - camera.y) * zoom;
+            const int blockRows = std::min(zoom, height - firstY);
+            const uint32_t* sourcePixel = &source.pixels[static_cast<size_t>(y) * source.width];
+            uint32_t* firstRow = &pixels[static_cast<size_t>(firstY) * width + firstX];
+
+            if (zoom == 1) {
+                memcpy(firstRow, sourcePixel + beginX, rowBytes);
+                continue;
+            }
+
+            uint32_t* pixel = firstRow;
+            for (int x = beginX, outX = firstX; x < endX; x++, outX += zoom) {
+                const int blockColumns = std::min(zoom, lastX - outX);
+                std::fill_n(pixel, blockColumns, sourcePixel[x]);
+                pixel += blockColumns;
+            }
+            for (int row = 1; row < blockRows; row++) {
+                memcpy(firstRow + static_cast<size_t>(row) * width, firstRow, rowBytes);
+            }
+        }
+    }
+};
+
+#endif //SCALED_FRAME_H
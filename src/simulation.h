@@ -0,0 +1,230 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <chrono> // Includes the chrono library for timing the chunks when profiling.
+#include <numeric> // Includes the numeric library for filling the update orders.
+#include "world.h"
+#include "particleRegistry.h"
+#include "grid.h"
+#include "threadPool.h"
+
+// The number of precomputed orders used by TraversalOrder::RotatingPermutations.
+constexpr int PERMUTATION_COUNT = 8;
+
+static_assert(CHUNK_SIZE <= 64, "The random row directions of a chunk are stored as one bit per row in a 64-bit word.");
+
+// What happened in a chunk during the last frame. Only measured while profiling.
+struct ChunkActivity {
+    uint32_t updates = 0; // The number of particles updated.
+    uint32_t moves = 0; // The number of particles that moved or changed when they were updated.
+    float microseconds = 0.0f; // How long the chunk took to update.
+};
+
+// Runs the rules of every particle in the world, one frame at a time. Only the chunks that changed last frame are updated.
+// The chunks are updated in four phases, in a checkerboard pattern, so that the chunks of a phase never touch the same cells
+// and can be updated on different threads. The result only depends on the seed, not on the number of threads.
+class Simulation {
+public:
+    Simulation(World& world, const int threads, const uint64_t seed, const TraversalOrder order = TRAVERSAL_ORDER,
+               const RandomMode randomMode = RANDOM_MODE, const bool specializedKernels = true)
+        : order(order), randomMode(randomMode), world(world), pool(threads), chunkOrder(world.chunks.size()), permutations(PERMUTATION_COUNT) {
+        // Picks the kernels specialized for the size of the world, if there are any, or the generic ones otherwise.
+        if (specializedKernels) {
+            dispatchGridSize(StandardGridSizes{}, world.width, world.height, [this](auto size) {
+                updateChunkKernel = &Simulation::updateChunk<decltype(size), false>;
+                profiledChunkKernel = &Simulation::updateChunk<decltype(size), true>;
+                specialized = decltype(size)::width > 0;
+            });
+        }
+
+        randomService.seed(seed);
+        g = randomService.stream(0);
+        world.seed(randomService);
+        std::iota(chunkOrder.begin(), chunkOrder.end(), 0); // Fills chunkOrder with consecutive numbers.
+        for (std::vector<int>& phase : phases) phase.reserve(chunkOrder.size());
+        activity.resize(world.chunks.size());
+
+        // Shuffles the precomputed orders once, up front.
+        for (std::array<int, CHUNK_SIZE * CHUNK_SIZE>& permutation : permutations) {
+            std::iota(permutation.begin(), permutation.end(), 0);
+            std::shuffle(permutation.begin(), permutation.end(), g);
+        }
+    }
+
+    // Updates every particle in the chunks that changed last frame.
+    void update() {
+        world.beginFrame();
+
+        // Shuffles the order of the chunks, which is cheap as there are few of them.
+        std::shuffle(chunkOrder.begin(), chunkOrder.end(), g);
+
+        // Picks the order of the cells within each chunk.
+        if (order == TraversalOrder::Shuffled) {
+            std::shuffle(permutations[0].begin(), permutations[0].end(), g);
+            cellOrder = &permutations[0];
+        } else if (order == TraversalOrder::RotatingPermutations) {
+            cellOrder = &permutations[frame % PERMUTATION_COUNT];
+        }
+
+        // Sorts the chunks that changed last frame into the four phases. Chunks are skipped entirely if nothing in them changed.
+        // The phases of the even and odd columns of chunks swap every frame. Otherwise the particles on the right side of every other
+        // border between two chunks would always move first, and win every cell they share with the particles on the left.
+        activeChunks = 0;
+        for (std::vector<int>& phase : phases) phase.clear();
+        for (const int chunkIndex : chunkOrder) {
+            if (world.chunks[chunkIndex].dirty.empty()) continue;
+
+            const int chunkX = chunkIndex % world.chunksX;
+            const int chunkY = chunkIndex / world.chunksX;
+            phases[(chunkY % 2) * 2 + (chunkX + frame) % 2].push_back(chunkIndex);
+            activeChunks++;
+        }
+
+        // When profiling, the chunks are updated with kernels that also measure them. The chunks that aren't updated did nothing.
+        void (Simulation::*kernel)(int) = updateChunkKernel;
+        if (profiling) {
+            kernel = profiledChunkKernel;
+            std::fill(activity.begin(), activity.end(), ChunkActivity{});
+        }
+
+        // Updates the phases one after another. The chunks within a phase are at least one chunk apart, so they can run in parallel.
+        for (const std::vector<int>& phase : phases) {
+            pool.run(static_cast<int>(phase.size()), [this, kernel, &phase](const int i) { (this->*kernel)(phase[i]); });
+        }
+
+        // Adds up how many particles slid down to each side, to measure if the update order is biased.
+        for (Chunk& chunk : world.chunks) {
+            diagonalMoves[0] += chunk.diagonalMoves[0].load(std::memory_order_relaxed);
+            diagonalMoves[1] += chunk.diagonalMoves[1].load(std::memory_order_relaxed);
+        }
+
+        frame++;
+    }
+
+    // Measures how biased the update order is, as the difference between the number of particles that slid down to the right and to the left,
+    // relative to the total. 0 means the particles pile up symmetrically, while -1 and 1 mean they all slide to the left or right respectively.
+    double bias() const {
+        const uint64_t total = diagonalMoves[0] + diagonalMoves[1];
+        return total == 0 ? 0.0 : (static_cast<double>(diagonalMoves[1]) - static_cast<double>(diagonalMoves[0])) / static_cast<double>(total);
+    }
+
+    // Checks if the simulation uses kernels specialized for the size of the world.
+    bool specializedKernels() const {
+        return specialized;
+    }
+
+    // The number of threads used to update the world.
+    int threads() const {
+        return pool.size();
+    }
+
+    int activeChunks = 0; // The number of chunks that were updated last frame.
+    bool profiling = false; // Whether to measure what happens in every chunk. Off by default, as measuring isn't free.
+    std::vector<ChunkActivity> activity; // What happened in every chunk last frame, if profiling was on.
+    TraversalOrder order; // The order in which the cells within a chunk are updated.
+    RandomMode randomMode; // Where the random numbers used by the particles come from.
+
+private:
+    World& world;
+    uint64_t frame = 0; // The number of frames simulated so far.
+    uint64_t diagonalMoves[2]{}; // The number of times a particle slid down to the left and to the right, since the simulation started.
+
+    Random g; // The random number generator used when shuffling the update orders.
+    ThreadPool pool; // The threads used to update the chunks.
+
+    std::vector<int> chunkOrder; // The order in which the chunks are updated.
+    std::vector<std::array<int, CHUNK_SIZE * CHUNK_SIZE>> permutations; // The shuffled orders of the cells within a chunk.
+    const std::array<int, CHUNK_SIZE * CHUNK_SIZE>* cellOrder = nullptr; // The shuffled order used this frame.
+    std::array<std::vector<int>, 4> phases; // The chunks to update in each of the four phases.
+
+    void (Simulation::*updateChunkKernel)(int) = &Simulation::updateChunk<RuntimeSize, false>; // The kernel used to update a chunk.
+    void (Simulation::*profiledChunkKernel)(int) = &Simulation::updateChunk<RuntimeSize, true>; // The same kernel, measuring the chunk as well.
+    bool specialized = false; // If updateChunkKernel is specialized for the size of the world.
+
+    // Updates the particle in the given cell, if it hasn't been updated already.
+    // When profiled, counts the update, and the move if the cell holds something else afterwards.
+    template <typename Size, bool Profiled>
+    void updateCell(WorldView<Size>& view, const int x, const int y, Random& rng, ChunkActivity* chunkActivity) {
+        const Cell& cell = view.at(x, y);
+        if (cell.id() != 0 && !view.updatedThisFrame(cell)) {
+            [[maybe_unused]] const uint8_t material = cell.material; // Only read when profiled.
+            if (randomMode == RandomMode::Counter) {
+                Random cellRandom = randomService.cellCounterStream(frame, view.index(x, y));
+                ParticleRegistry::update(view, x, y, cellRandom);
+            } else {
+                ParticleRegistry::update(view, x, y, rng);
+            }
+
+            if constexpr (Profiled) {
+                chunkActivity->updates++;
+                if (cell.material != material) chunkActivity->moves++;
+            }
+        }
+    }
+
+    // Updates every particle in the dirty rectangle of the given chunk. Compiled once for every standard world size, as well as once for any size,
+    // and all of those once more with profiling, so that the kernels used when it is off don't measure anything.
+    template <typename Size, bool Profiled>
+    void updateChunk(const int chunkIndex) {
+        if constexpr (Profiled) {
+            const auto start = std::chrono::steady_clock::now();
+            updateCells<Size, true>(chunkIndex, &activity[chunkIndex]);
+            activity[chunkIndex].microseconds = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+        } else {
+            updateCells<Size, false>(chunkIndex, nullptr);
+        }
+    }
+
+    // Updates the particles in the dirty rectangle of the given chunk, in the traversal order.
+    template <typename Size, bool Profiled>
+    void updateCells(const int chunkIndex, ChunkActivity* chunkActivity) {
+        Chunk& chunk = world.chunks[chunkIndex];
+        WorldView<Size> view(world);
+
+        // Clips the dirty rectangle to the world, as chunks at the edges may be cut off.
+        const int minX = std::max(chunk.dirty.minX, 0);
+        const int minY = std::max(chunk.dirty.minY, 0);
+        const int maxX = std::min(chunk.dirty.maxX, view.width() - 1);
+        const int maxY = std::min(chunk.dirty.maxY, view.height() - 1);
+
+        if (order == TraversalOrder::Shuffled || order == TraversalOrder::RotatingPermutations) {
+            const int chunkX = (chunkIndex % world.chunksX) * CHUNK_SIZE;
+            const int chunkY = (chunkIndex / world.chunksX) * CHUNK_SIZE;
+
+            for (const int i : *cellOrder) {
+                const int x = chunkX + i % CHUNK_SIZE;
+                const int y = chunkY + i / CHUNK_SIZE;
+
+                // Skips the cells outside the dirty rectangle.
+                if (x < minX || x > maxX || y < minY || y > maxY) continue;
+
+                updateCell<Size, Profiled>(view, x, y, chunk.rng, chunkActivity);
+            }
+            return;
+        }
+
+        // Generates the random directions of all the rows at once, one bit per row.
+        uint64_t rowDirections = 0;
+        if (order == TraversalOrder::RandomRows) {
+            if (randomMode == RandomMode::Counter) {
+                randomService.chunkCounterStream(frame, chunkIndex).fillBits(&rowDirections, 1);
+            } else {
+                chunk.rng.fillBits(&rowDirections, 1);
+            }
+        }
+
+        // Goes through the rows from the bottom up, so that falling particles move as a whole, and only the direction of each row changes.
+        // Alternating rows flip every frame, and the whole pattern shifts by a row every other frame. Particles sliding down a slope move
+        // one row per frame, so with y + frame alone they would see the same direction all the way down, and lean towards it.
+        for (int y = maxY; y >= minY; y--) {
+            const bool leftToRight = order == TraversalOrder::AlternatingRows ? ((y + frame + frame / 2) % 2 == 0) : ((rowDirections >> (y % CHUNK_SIZE)) & 1);
+            if (leftToRight) {
+                for (int x = minX; x <= maxX; x++) updateCell<Size, Profiled>(view, x, y, chunk.rng, chunkActivity);
+            } else {
+                for (int x = maxX; x >= minX; x--) updateCell<Size, Profiled>(view, x, y, chunk.rng, chunkActivity);
+            }
+        }
+    }
+};
+
+#endif //SIMULATION_H
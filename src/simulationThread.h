@@ -0,0 +1,335 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <atomic> // Includes the atomic library for the flags shared with the main thread.
+#include <condition_variable> // Includes the condition_variable library for waking the simulation thread up when it is idle.
+#include <cstdlib> // Includes the cstdlib library for abs.
+#include <limits> // Includes the limits library for an unlimited overview update.
+#include <mutex> // Includes the mutex library for protecting the queued brush strokes.
+#include <thread> // Includes the thread library for running the simulation on its own thread.
+#include <vector> // Includes the vector library for the queued brush strokes.
+#include "globals.h" // Includes the globals.h header file.
+#include "world.h" // Includes the world.h header file.
+#include "stats.h" // Includes the stats.h header file.
+#include "particleRegistry.h" // Includes the particle registry, for creating the particles of the brush.
+#include "simulation.h" // Includes the simulation.h header file.
+#include "frameBuffer.h" // Includes the frameBuffer.h header file.
+#include "mipPyramid.h" // Includes the mipPyramid.h header file.
+#include "tripleBuffer.h" // Includes the tripleBuffer.h header file.
+#include "frameScheduler.h" // Includes the frameScheduler.h header file.
+#include "frameExporter.h" // Includes the frameExporter.h header file.
+#include "activityMap.h" // Includes the activityMap.h header file.
+
+// A stroke of the brush from one position in the world to another, queued by the main thread.
+struct BrushStroke {
+    int x1, y1, x2, y2; // The start and end of the stroke, in cells.
+    int radius; // The radius of the brush, in cells.
+    bool place; // Whether to place particles, like when the left mouse button is held.
+    bool erase; // Whether to remove particles, like when the right mouse button is held.
+    int typeIndex; // The index of the particle type to place.
+};
+
+// Everything the main thread needs to show a frame, published by the simulation thread after every tick.
+struct RenderSnapshot {
+    FrameBuffer frame; // The image of the world.
+    MipPyramid overview; // The smaller images of the whole world, for the overview and the minimap.
+    Heatmap heatmap; // How active every chunk was, if the heatmap is on.
+    SimulationStats stats; // The statistics of the tick the image was taken after.
+
+    RenderSnapshot(const int width, const int height, const int overviewWidth, const int overviewHeight)
+        : frame(width, height), overview(width, height, overviewWidth, overviewHeight), heatmap(width, height) {}
+};
+
+// Draws a brush stroke into the world. An interpolation function that relies on Bresenham's line algorithm.
+inline void interpolate(World& world, const BrushStroke& stroke) {
+    int x1 = stroke.x1;
+    int y1 = stroke.y1;
+    const int dx = abs(stroke.x2 - x1);
+    const int dy = abs(stroke.y2 - y1);
+    const int sx = (x1 < stroke.x2) ? 1 : -1;
+    const int sy = (y1 < stroke.y2) ? 1 : -1;
+    int err = dx - dy;
+
+    while (true) {
+        for (int i = -stroke.radius; i <= stroke.radius; i++) {
+            for (int j = -stroke.radius; j <= stroke.radius; j++) {
+                if (i * i + j * j <= stroke.radius * stroke.radius) {
+                    const int brushX = x1 + i;
+                    const int brushY = y1 + j;
+
+                    // Checks if the brush is within the bounds of the world.
+                    if (world.inBounds(brushX, brushY)) {
+                        if (stroke.place && world.at(brushX, brushY).id() == 0) { // If the user is left clicking.
+                            // Creates a new particle at the current position based on the current particle type.
+                            world.set(brushX, brushY, ParticleRegistry::create(particleTypes[stroke.typeIndex], threadRandom()));
+                        }
+                        else if (stroke.erase) { // If the user is right clicking.
+                            world.clear(brushX, brushY); // Deletes the particle at the current position.
+                        }
+                    }
+                }
+            }
+        }
+
+        if (x1 == stroke.x2 && y1 == stroke.y2) break;
+        const int e2 = 2 * err;
+        if (e2 > -dy) { err -= dy; x1 += sx; }
+        if (e2 < dx) { err += dx; y1 += sy; }
+    }
+}
+
+// Runs the simulation on its own thread, at the target tick rate, so that waiting for the display never slows it down.
+// The ticks are run on a fixed timestep, and several of them are run before the next image when the simulation falls behind.
+// In turbo mode, the simulation runs as many ticks as it can, and only builds an image once per frame.
+// When the simulation is paused or nothing in the world moves, the thread sleeps until the main thread gives it something to do.
+// After every tick, the image of the world is published through a triple buffer, and the main thread shows the most recent one.
+// The main thread never touches the world directly. The brush strokes are queued, and drawn by the simulation thread before its next tick.
+class SimulationThread {
+public:
+    // The overview images are made small enough to fit in the given size, usually the size of the window.
+    // If uncapped, the simulation runs as fast as it can instead of at the target tick rate, for benchmarking.
+    // If an exporter is given, it is handed every tick that is simulated.
+    SimulationThread(World& world, Simulation& simulation, const DirtyRect& viewport, const int overviewWidth, const int overviewHeight,
+        const bool uncapped, FrameExporter* exporter) : world(world), simulation(simulation),
+        snapshots(world.width, world.height, overviewWidth, overviewHeight), uncapped(uncapped), exporter(exporter), activity(world.chunks.size()) {
+        setViewport(viewport);
+        pendingStrokes.reserve(256);
+        strokes.reserve(256);
+
+        // Sizes the change tracking of every buffer before the main thread can get hold of one.
+        collectChanges();
+
+        thread = std::thread([this] { run(); });
+    }
+
+    ~SimulationThread() {
+        stopping.store(true, std::memory_order_relaxed);
+        wake();
+        thread.join();
+    }
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // Queues a brush stroke, to be drawn before the next tick.
+    void paint(const BrushStroke& stroke) {
+        {
+            std::lock_guard<std::mutex> lock(strokeMutex);
+            pendingStrokes.push_back(stroke);
+            idleFlag.store(false, std::memory_order_relaxed);
+        }
+        wakeUp.notify_one();
+    }
+
+    void setPaused(const bool paused) {
+        pausedFlag.store(paused, std::memory_order_relaxed);
+        wake();
+    }
+
+    // Turns turbo mode on or off. In turbo mode, the ticks are run back to back for as long as a frame lasts, and only the image
+    // after the last one is built, so the simulation runs as fast as the CPU allows while the window still shows it at its own rate.
+    void setTurbo(const bool turbo) {
+        turboFlag.store(turbo, std::memory_order_relaxed);
+        wake();
+    }
+
+    // Sets what the heatmap shows. While it is off, the chunks aren't measured at all.
+    void setHeatmap(const HeatmapMode mode) {
+        heatmapMode.store(mode, std::memory_order_relaxed);
+        wake();
+    }
+
+    // Sets the cells that the camera sees. Only the changes in view are drawn into the images, the others wait until they come into view.
+    void setViewport(const DirtyRect& viewport) {
+        viewportMinX.store(viewport.minX, std::memory_order_relaxed);
+        viewportMinY.store(viewport.minY, std::memory_order_relaxed);
+        viewportMaxX.store(viewport.maxX, std::memory_order_relaxed);
+        viewportMaxY.store(viewport.maxY, std::memory_order_relaxed);
+        wake();
+    }
+
+    // Checks if the simulation thread is waiting for something to do, and the last image it published is up to date.
+    // Nothing changes until the main thread paints, unpauses, turns on turbo mode or moves the camera, so it doesn't have to draw new frames either.
+    bool idle() const {
+        return idleFlag.load(std::memory_order_acquire);
+    }
+
+    // Takes the most recent snapshot, if a new one was published since the last call. Returns nullptr otherwise.
+    // The snapshot belongs to the main thread until the next call.
+    RenderSnapshot* acquire() {
+        return snapshots.acquire() ? &snapshots.readBuffer() : nullptr;
+    }
+
+private:
+    World& world;
+    Simulation& simulation;
+    TripleBuffer<RenderSnapshot> snapshots;
+    const bool uncapped; // Whether the ticks are run as fast as possible.
+    FrameExporter* exporter; // Where the ticks are exported to, if anywhere.
+    ActivityMap activity; // The average activity of every chunk, while the heatmap is on. Only used by the simulation thread.
+
+    std::mutex strokeMutex;
+    std::vector<BrushStroke> pendingStrokes; // The strokes queued by the main thread. Protected by the mutex.
+    std::vector<BrushStroke> strokes; // The strokes being drawn by the simulation thread.
+    std::condition_variable wakeUp; // Wakes the simulation thread up when it is idle.
+    bool wakeRequested = false; // Whether something changed that the simulation thread has to look at. Protected by the mutex.
+
+    std::atomic<bool> pausedFlag{false};
+    std::atomic<bool> turboFlag{false};
+    std::atomic<bool> idleFlag{false};
+    std::atomic<HeatmapMode> heatmapMode{HeatmapMode::Off};
+    std::atomic<int> viewportMinX{0}, viewportMinY{0}, viewportMaxX{-1}, viewportMaxY{-1}; // The cells the camera sees.
+    std::atomic<bool> stopping{false};
+    std::thread thread;
+
+    void run() {
+        FixedTimestep timestep(TARGET_FRAME_TIME);
+        SimulationStats stats; // Keeps track of heap allocations per tick, to make sure the simulation doesn't allocate once warmed up.
+        DirtyRect lastViewport; // The viewport of the last tick.
+        bool wasTurbo = false;
+        uint64_t ticksThisSecond = 0; // The ticks run since the tick rate was last measured.
+        auto secondStart = SchedulerClock::now();
+
+        while (!stopping.load(std::memory_order_relaxed)) {
+            // Turbo mode does nothing while paused. When it ends, the time it ran for is forgotten, so the ticks aren't made up for.
+            const bool paused = pausedFlag.load(std::memory_order_relaxed);
+            const bool turbo = turboFlag.load(std::memory_order_relaxed) && !paused;
+            if (wasTurbo && !turbo) timestep.reset();
+            wasTurbo = turbo;
+
+            // Only measures the chunks while the heatmap is on. When it is turned on, the averages start over.
+            const HeatmapMode heatmap = heatmapMode.load(std::memory_order_relaxed);
+            if (heatmap != HeatmapMode::Off && !simulation.profiling) activity.reset();
+            simulation.profiling = heatmap != HeatmapMode::Off;
+
+            // Waits until a tick is due. Uncapped or in turbo mode, a tick is run every time, right away.
+            const int ticks = uncapped || turbo ? 1 : timestep.ticksDue();
+            if (ticks == 0) {
+                timestep.waitForTick();
+                continue;
+            }
+
+            // Draws the strokes queued since the last tick.
+            {
+                std::lock_guard<std::mutex> lock(strokeMutex);
+                strokes.swap(pendingStrokes);
+            }
+            for (const BrushStroke& stroke : strokes) interpolate(world, stroke);
+            strokes.clear();
+
+            stats.beginFrame();
+
+            // Runs the ticks that are due back to back, updating the chunks of the world that changed the tick before.
+            // Every buffer remembers the cells that changed, including the ones changed by the brush, which the simulation forgets
+            // when it starts the new tick. The image is only built after the last one. In turbo mode, ticks keep being run
+            // until a frame's worth of time has passed.
+            const auto turboEnd = SchedulerClock::now() + secondsToDuration(TARGET_FRAME_TIME);
+            int ticksRun = 0;
+            do {
+                collectChanges();
+                if (!paused) simulation.update();
+                collectChanges();
+                if (!paused) {
+                    if (simulation.profiling) activity.add(simulation.activity);
+                    if (!world.settled()) driftSandColor(); // A settled world keeps its colors, so that it can go idle.
+                    if (exporter) exporter->onTick(world);
+                }
+                ticksRun++;
+            } while (ticksRun < ticks || (turbo && SchedulerClock::now() < turboEnd));
+            stats.activeChunks = paused ? 0 : simulation.activeChunks;
+            stats.bias = simulation.bias();
+            stats.ticksPerFrame = ticksRun;
+            stats.turbo = turbo;
+
+            // Measures the number of ticks run per second, once every second.
+            ticksThisSecond += paused ? 0 : ticksRun;
+            const auto now = SchedulerClock::now();
+            if (now - secondStart >= std::chrono::seconds(1)) {
+                stats.ticksPerSecond = static_cast<double>(ticksThisSecond) / std::chrono::duration<double>(now - secondStart).count();
+                ticksThisSecond = 0;
+                secondStart = now;
+            }
+
+            // When the camera moves, everything that comes into view is drawn again in every buffer,
+            // as the buffers may have skipped the changes there while it was out of view.
+            const DirtyRect viewport{viewportMinX.load(std::memory_order_relaxed), viewportMinY.load(std::memory_order_relaxed),
+                viewportMaxX.load(std::memory_order_relaxed), viewportMaxY.load(std::memory_order_relaxed)};
+            if (viewport.minX != lastViewport.minX || viewport.minY != lastViewport.minY || viewport.maxX != lastViewport.maxX ||
+                viewport.maxY != lastViewport.maxY) {
+                for (int i = 0; i < 3; i++) snapshots.buffer(i).frame.invalidateArea(viewport);
+                lastViewport = viewport;
+            }
+
+            // Draws the cells in view that changed into the write buffer, and hands it to the main thread.
+            // The image in view is always up to date, so the thread can go idle once nothing can change anymore. Before it does,
+            // the overview catches up on everything it has left, as nothing would update it while the thread sleeps.
+            const bool goingIdle = paused || world.settled();
+            RenderSnapshot& snapshot = snapshots.writeBuffer();
+            snapshot.frame.buildChanged(world, viewport);
+            snapshot.overview.update(world, goingIdle ? std::numeric_limits<uint64_t>::max() : MipPyramid::MAX_CELLS_PER_UPDATE);
+            stats.cellsRedrawn = snapshot.frame.cellsRedrawn;
+            stats.bytesUploaded = snapshot.frame.bytesUploaded;
+            stats.cellsReduced = snapshot.overview.cellsReduced;
+            if (heatmap != HeatmapMode::Off) activity.build(heatmap, snapshot.heatmap);
+            else snapshot.heatmap.mode = HeatmapMode::Off;
+            stats.heatmapPeak = snapshot.heatmap.peak;
+            stats.heatmapUnit = snapshot.heatmap.unit();
+            if (exporter) {
+                stats.framesExported = exporter->framesWritten();
+                stats.exportStalls = exporter->stalls();
+            }
+            stats.endFrame();
+            snapshot.stats = stats;
+            snapshots.publish();
+
+            // Sleeps if nothing can change until the main thread asks for something, so a paused or settled world costs nothing.
+            // The image that was just published stays on the screen in the meantime.
+            if (goingIdle) waitForWork(timestep);
+        }
+    }
+
+    // Marks the thread as idle and waits until it is woken up. Changes made while it was busy wake it up right away,
+    // as it may not have seen them yet.
+    void waitForWork(FixedTimestep& timestep) {
+        std::unique_lock<std::mutex> lock(strokeMutex);
+        if (!wakeRequested && pendingStrokes.empty()) {
+            idleFlag.store(true, std::memory_order_release);
+            wakeUp.wait(lock, [this] { return wakeRequested || !pendingStrokes.empty(); });
+            timestep.reset(); // The time spent waiting isn't made up for.
+        }
+        wakeRequested = false;
+    }
+
+    // Tells the simulation thread that something changed, waking it up if it is idle.
+    void wake() {
+        {
+            std::lock_guard<std::mutex> lock(strokeMutex);
+            wakeRequested = true;
+            idleFlag.store(false, std::memory_order_relaxed);
+        }
+        wakeUp.notify_one();
+    }
+
+    // Makes the color of the sand particles change slightly over time. Only the palette changes, not the particles.
+    static void driftSandColor() {
+        const int oldMask = static_cast<int>(sandColorMask);
+        sandColorMask += 0.1f * static_cast<float>(sandColorSwitch);
+        if (sandColorMask >= 5.0f) {
+            sandColorSwitch = -1;
+        } else if (sandColorMask <= -15.0f) {
+            sandColorSwitch = 1;
+        }
+        if (static_cast<int>(sandColorMask) != oldMask) palette.rebuild();
+    }
+
+    // Remembers the cells that changed in the world in every buffer, for both the image and the overview. The main thread only uses
+    // the regions of its buffer, never the changes that are still waiting to be drawn, so this is safe while it uploads.
+    void collectChanges() {
+        for (int i = 0; i < 3; i++) {
+            snapshots.buffer(i).frame.collectChanges(world);
+            snapshots.buffer(i).overview.collectChanges(world);
+        }
+    }
+};
+
+#endif //SIMULATION_THREAD_H
@@ -0,0 +1,69 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic> // Includes the atomic library for counters that can be updated from any thread.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <cstdio> // Includes the cstdio library for formatting the statistics.
+
+// The number of heap allocations made since the program started. Incremented by the operator new in allocationCounter.cpp.
+inline std::atomic<uint64_t> heapAllocations{0};
+
+// The number of frames to wait before the scene counts as warmed up, and allocations during a frame count as unexpected.
+constexpr uint64_t WARMUP_FRAMES = 120;
+
+// Statistics about the simulation, shown in the window title.
+struct SimulationStats {
+    uint64_t frames{}; // The number of frames simulated so far.
+    uint64_t frameAllocations{}; // The number of heap allocations made during the last frame.
+    uint64_t steadyStateAllocations{}; // The number of heap allocations made during frames after the warmup.
+    uint64_t framesWithAllocations{}; // The number of frames after the warmup that made any heap allocations.
+
+    uint64_t allocationsAtFrameStart{}; // The allocation counter when the current frame started.
+
+    int activeChunks{}; // The number of chunks that were updated last frame.
+    int ticksPerFrame{}; // The number of ticks run before the last image. More than one when the simulation is catching up, or in turbo mode.
+    double ticksPerSecond{}; // The number of ticks run per second, measured over the last second.
+    bool turbo{}; // Whether the simulation is running in turbo mode.
+    uint64_t framesExported{}; // The number of frames written by the exporter so far.
+    uint64_t exportStalls{}; // The number of times the simulation had to wait for the exporter.
+    double bias{}; // How biased the update order is, from -1 (everything slides left) to 1 (everything slides right).
+    uint64_t cellsRedrawn{}; // The number of cells drawn again last frame, because they changed.
+    uint64_t bytesUploaded{}; // The number of bytes uploaded to the screen last frame.
+    uint64_t cellsReduced{}; // The number of cells reduced into the overview last frame, because they changed.
+    double heatmapPeak{}; // The activity of the most active chunk on the heatmap.
+    const char* heatmapUnit{}; // The unit of the heatmap, or nullptr if it is off.
+
+    // Marks the start of the part of the frame that should not allocate.
+    void beginFrame() {
+        allocationsAtFrameStart = heapAllocations.load(std::memory_order_relaxed);
+    }
+
+    // Marks the end of the frame, and counts the allocations made since beginFrame().
+    void endFrame() {
+        frameAllocations = heapAllocations.load(std::memory_order_relaxed) - allocationsAtFrameStart;
+        if (frames >= WARMUP_FRAMES && frameAllocations > 0) {
+            steadyStateAllocations += frameAllocations;
+            framesWithAllocations++;
+        }
+        frames++;
+    }
+
+    // Writes the statistics as a single line of text into the given buffer. The export statistics are only added once something was exported,
+    // and the heatmap statistics while it is on.
+    void format(char* buffer, const size_t size) const {
+        int length = snprintf(buffer, size, "%sticks/s: %.0f | ticks per frame: %d | active chunks: %d | bias: %+.3f | redrawn: %llu cells, %llu KB | overview: %llu cells | allocations: %llu last frame, %llu in %llu frames since warmup",
+            turbo ? "TURBO | " : "", ticksPerSecond, ticksPerFrame, activeChunks, bias, static_cast<unsigned long long>(cellsRedrawn), static_cast<unsigned long long>(bytesUploaded / 1024),
+            static_cast<unsigned long long>(cellsReduced),
+            static_cast<unsigned long long>(frameAllocations), static_cast<unsigned long long>(steadyStateAllocations),
+            static_cast<unsigned long long>(framesWithAllocations));
+        if (length > 0 && static_cast<size_t>(length) < size && (framesExported > 0 || exportStalls > 0)) {
+            length += snprintf(buffer + length, size - length, " | exported: %llu frames, %llu stalls",
+                static_cast<unsigned long long>(framesExported), static_cast<unsigned long long>(exportStalls));
+        }
+        if (length > 0 && static_cast<size_t>(length) < size && heatmapUnit) {
+            snprintf(buffer + length, size - length, " | heatmap peak: %.1f %s", heatmapPeak, heatmapUnit);
+        }
+    }
+};
+
+#endif //STATS_H
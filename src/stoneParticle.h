@@ -1,27 +1,28 @@
 #ifndef STONEPARTICLE_H
 #define STONEPARTICLE_H
 
-#include "globals.h"
+#include "world.h"
 
-// The stone particle class. Inherits from the particle class.
-class StoneParticle : public Particle {
+// The rules for the stone particle. Operates on the cells of the world.
+class StoneParticle {
 public:
-    StoneParticle(const int x, const int y) {
-        id = 2;
-        position = {x, y};
-        velocity = {};
-        color = stoneColor[rand() % 3];
-    }
+    static constexpr uint8_t id = 2;
+    static constexpr ParticleType type = ParticleType::Stone;
+    static constexpr char symbol = '#'; // The character used for this particle in text scenes.
+    static constexpr int shades = 3; // The number of colors this particle can have.
 
-    void update() override {
-        // Do nothing, as the stone particle simply stays put.
+    static Cell create(Random& rng) {
+        return Cell{makeMaterial(id, rng.below(3)), {0, 0}, 0};
     }
 
-    void render(SDL_Renderer* renderer, const int x, const int y) override {
-        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, 255);
+    static color_t color(const int shade) {
+        return stoneColor[shade];
+    }
 
-        const SDL_Rect rect = {x * PARTICLE_SIZE, y * PARTICLE_SIZE, PARTICLE_SIZE, PARTICLE_SIZE};
-        SDL_RenderFillRect(renderer, &rect);
+    // Updates the particle. Works on the world itself, as well as on any view of it with the same functions.
+    template <typename Grid>
+    static void update(Grid& /*world*/, int /*x*/, int /*y*/, Random& /*rng*/) {
+        // Do nothing, as the stone particle simply stays put.
     }
 };
 
@@ -0,0 +1,104 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic> // Includes the atomic library for handing out jobs between threads.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+#include <condition_variable> // Includes the condition_variable library for waking up the worker threads.
+#include <mutex> // Includes the mutex library for protecting the shared state of the pool.
+#include <thread> // Includes the thread library for creating the worker threads.
+#include <vector> // Includes the vector library for vectors.
+
+// A pool of worker threads that run a list of jobs in parallel. The calling thread helps out, so a pool of size 1 has no worker threads at all.
+class ThreadPool {
+public:
+    explicit ThreadPool(const int threads) {
+        for (int i = 1; i < threads; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // The number of threads that run jobs, including the calling thread.
+    int size() const {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    // Runs job(i) for every i from 0 to count - 1, spread over all the threads, and waits until they are all done.
+    // The job is passed by pointer instead of wrapped in a std::function, so that running it doesn't allocate.
+    template <typename Job>
+    void run(const int count, const Job& job) {
+        if (workers.empty() || count <= 1) {
+            for (int i = 0; i < count; i++) job(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            context = &job;
+            invoke = [](const void* context, const int i) { (*static_cast<const Job*>(context))(i); };
+            jobCount = count;
+            nextJob.store(0, std::memory_order_relaxed);
+            busyWorkers = static_cast<int>(workers.size());
+            generation++;
+        }
+        start.notify_all();
+
+        work();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable start; // Notified when there are new jobs to run, or when the pool is stopping.
+    std::condition_variable done; // Notified when the last worker has finished its jobs.
+
+    const void* context = nullptr; // The job that is currently being run.
+    void (*invoke)(const void* context, int i) = nullptr; // Calls the current job with the given index.
+    int jobCount = 0;
+    std::atomic<int> nextJob{0}; // The index of the next job to hand out.
+    int busyWorkers = 0; // The number of workers that haven't finished the current jobs yet.
+    uint64_t generation = 0; // Incremented every time new jobs are started.
+    bool stopping = false;
+
+    // Runs jobs until there are none left.
+    void work() {
+        int i;
+        while ((i = nextJob.fetch_add(1, std::memory_order_relaxed)) < jobCount) {
+            invoke(context, i);
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+            }
+
+            work();
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0) done.notify_one();
+        }
+    }
+};
+
+#endif //THREADPOOL_H
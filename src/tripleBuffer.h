@@ -0,0 +1,59 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic> // Includes the atomic library for handing the buffers between the threads.
+#include <cstdint> // Includes the cstdint library for fixed size integer types.
+
+// Three buffers shared by a single writer and a single reader, that never have to wait for each other.
+// The writer always has a buffer of its own to fill, and the reader always gets the most recent one that was finished.
+// Buffers that are finished while the reader is busy are simply replaced by newer ones.
+template <typename T>
+class TripleBuffer {
+public:
+    template <typename... Args>
+    explicit TripleBuffer(const Args&... args) : buffers{T(args...), T(args...), T(args...)} {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // The buffer that the writer is filling.
+    T& writeBuffer() {
+        return buffers[writeIndex];
+    }
+
+    // The buffer that the reader is showing.
+    T& readBuffer() {
+        return buffers[readIndex];
+    }
+
+    // All three buffers, for changes that have to be made to each of them. Only safe to use from the writer for the write buffer,
+    // unless it's known that the reader isn't running.
+    T& buffer(const int i) {
+        return buffers[i];
+    }
+
+    // Hands the write buffer to the reader, and gives the writer the buffer that was waiting for the reader before, if it never took it.
+    void publish() {
+        const uint8_t previous = middle.exchange(static_cast<uint8_t>(writeIndex | FRESH), std::memory_order_acq_rel);
+        writeIndex = previous & INDEX;
+    }
+
+    // Takes the most recent finished buffer, if there is a new one. Returns false if nothing was published since the last call.
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        const uint8_t previous = middle.exchange(static_cast<uint8_t>(readIndex), std::memory_order_acq_rel);
+        readIndex = previous & INDEX;
+        return true;
+    }
+
+private:
+    static constexpr uint8_t INDEX = 3; // The bits of the middle slot that hold the index of the buffer.
+    static constexpr uint8_t FRESH = 4; // Set in the middle slot when it holds a buffer that the reader hasn't taken yet.
+
+    T buffers[3];
+    int writeIndex = 0; // Only used by the writer.
+    int readIndex = 1; // Only used by the reader.
+    std::atomic<uint8_t> middle{2}; // The buffer in between the two, which is swapped with the writer's or the reader's buffer.
+};
+
+#endif //TRIPLE_BUFFER_H
@@ -0,0 +1,256 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <atomic> // Includes the atomic library for dirty rectangles that can be grown from several threads.
+#include <limits> // Includes the limits library for the bounds of empty dirty rectangles.
+#include "globals.h"
+
+// The size of a chunk, in cells. The world is split into chunks, so that the parts of it that haven't changed can be skipped.
+constexpr int CHUNK_SIZE = 64;
+
+// Velocities are stored as fixed point numbers with 4 fractional bits, so that each component fits in a single byte.
+constexpr int VELOCITY_SCALE = 16;
+constexpr int MAX_VELOCITY = 127; // The largest velocity a cell can store. Just under 8 cells per frame.
+
+// The furthest a particle can read or write from its own cell in a single update. Fire moves up to a full velocity, then looks
+// two more steps ahead from where it lands, and marking a cell dirty touches one cell past that.
+// Chunks are updated in parallel with at least one chunk between them, so this has to stay below half a chunk.
+constexpr int MAX_REACH = 3 * (MAX_VELOCITY / VELOCITY_SCALE) + 1;
+static_assert(MAX_REACH < CHUNK_SIZE / 2, "Particles must not be able to reach past half a chunk in a single update.");
+
+// The gravity constant converted to fixed point. Divides by 50 to make the gravity effect weaker.
+constexpr int GRAVITY_STEP = static_cast<int>(GRAVITY / 50.0f * VELOCITY_SCALE + 0.5f);
+
+// The three x-directions to check below a falling particle, in every possible order. Picking one at random is the same as shuffling them.
+constexpr std::array<std::array<int, 3>, 6> DIRECTION_ORDERS = {{{-1, 0, 1}, {-1, 1, 0}, {0, -1, 1}, {0, 1, -1}, {1, -1, 0}, {1, 0, -1}}};
+
+// The number of different frame stamps. Stamps count from 1 up to this, and 0 is never used for a frame, so that new cells are never stamped.
+constexpr int STAMP_COUNT = 255;
+
+// The number of low bits of a cell's material that hold the ID of its particle. The bits above hold its shade.
+constexpr int ID_BITS = 6;
+constexpr uint8_t ID_MASK = (1 << ID_BITS) - 1;
+constexpr int SHADE_COUNT = 1 << (8 - ID_BITS); // The most shades a particle type can have.
+
+// Combines the ID of a particle and its shade into a material.
+constexpr uint8_t makeMaterial(const uint8_t id, const uint32_t shade) {
+    return static_cast<uint8_t>(id | shade << ID_BITS);
+}
+
+// A single cell of the world. Cells are stored by value in one contiguous array, so that checking a neighbor is just an offset in memory.
+struct Cell {
+    uint8_t material; // The ID of the particle in this cell and which of its colors to use, 0 meaning the cell is empty. Also the index of its color in the palette.
+    int8_t velocity[2]; // The x and y velocity of the particle, in 1/VELOCITY_SCALE cells per frame.
+    uint8_t stamp; // The stamp of the last frame this cell was updated in. Used to prevent it from being updated multiple times in one frame.
+
+    // The ID of the particle in this cell. Used to determine the type of the particle, 0 means the cell is empty.
+    uint8_t id() const {
+        return material & ID_MASK;
+    }
+
+    // Which of the particle's colors to use.
+    uint8_t shade() const {
+        return material >> ID_BITS;
+    }
+};
+static_assert(sizeof(Cell) == 4, "Cells should fit in 4 bytes, so that the frame builder can read them as 32-bit words.");
+
+// Adds the given amount to a velocity component, clamping it so that it doesn't overflow.
+inline void addVelocity(int8_t& velocity, const int amount) {
+    velocity = static_cast<int8_t>(std::max(-MAX_VELOCITY, std::min(velocity + amount, MAX_VELOCITY)));
+}
+
+// A rectangle of cells that has changed, and needs to be updated. The bounds are inclusive.
+struct DirtyRect {
+    int minX = std::numeric_limits<int>::max(), minY = std::numeric_limits<int>::max();
+    int maxX = -1, maxY = -1;
+
+    bool empty() const {
+        return maxX < minX;
+    }
+
+    // Grows the rectangle to contain the given rectangle.
+    void include(const int x1, const int y1, const int x2, const int y2) {
+        minX = std::min(minX, x1);
+        minY = std::min(minY, y1);
+        maxX = std::max(maxX, x2);
+        maxY = std::max(maxY, y2);
+    }
+};
+
+// Lowers or raises an atomic value to the given value, if it is smaller or larger respectively.
+inline void atomicMin(std::atomic<int>& value, const int newValue) {
+    int current = value.load(std::memory_order_relaxed);
+    while (newValue < current && !value.compare_exchange_weak(current, newValue, std::memory_order_relaxed)) {}
+}
+
+inline void atomicMax(std::atomic<int>& value, const int newValue) {
+    int current = value.load(std::memory_order_relaxed);
+    while (newValue > current && !value.compare_exchange_weak(current, newValue, std::memory_order_relaxed)) {}
+}
+
+// A dirty rectangle that can be grown from several threads at once. Used for chunks that are written to by the chunks around them.
+struct AtomicDirtyRect {
+    std::atomic<int> minX{std::numeric_limits<int>::max()}, minY{std::numeric_limits<int>::max()};
+    std::atomic<int> maxX{-1}, maxY{-1};
+
+    // Grows the rectangle to contain the given rectangle.
+    void include(const int x1, const int y1, const int x2, const int y2) {
+        atomicMin(minX, x1);
+        atomicMin(minY, y1);
+        atomicMax(maxX, x2);
+        atomicMax(maxY, y2);
+    }
+
+    DirtyRect load() const {
+        return DirtyRect{minX.load(std::memory_order_relaxed), minY.load(std::memory_order_relaxed),
+            maxX.load(std::memory_order_relaxed), maxY.load(std::memory_order_relaxed)};
+    }
+
+    void reset() {
+        minX.store(std::numeric_limits<int>::max(), std::memory_order_relaxed);
+        minY.store(std::numeric_limits<int>::max(), std::memory_order_relaxed);
+        maxX.store(-1, std::memory_order_relaxed);
+        maxY.store(-1, std::memory_order_relaxed);
+    }
+};
+
+// A chunk of the world. Keeps track of which of its cells need to be updated.
+struct Chunk {
+    DirtyRect dirty; // The cells that changed last frame, and need to be updated this frame.
+    AtomicDirtyRect nextDirty; // The cells that changed this frame, and need to be updated next frame.
+    Random rng; // The random engine used by the particles in this chunk, so that the result doesn't depend on which thread updates it.
+    std::atomic<int> diagonalMoves[2]{}; // The number of times a particle in this chunk slid down to the left and to the right this frame.
+};
+
+// The world, stored as a packed grid of cells. The size of the world is picked at startup, and doesn't depend on the size of the window.
+class World {
+public:
+    const int width; // The width of the world, in cells. Also the stride between two rows of cells.
+    const int height; // The height of the world, in cells.
+
+    // The number of chunks in each direction. Chunks at the right and bottom edges may be cut off by the edge of the world.
+    const int chunksX;
+    const int chunksY;
+
+    std::vector<Cell> cells; // All the cells of the world, stored row by row.
+    std::vector<Chunk> chunks; // All the chunks of the world, stored row by row.
+    uint8_t stamp = 0; // The stamp of the current frame. Cells with this stamp have already been updated this frame.
+
+    World(const int width, const int height)
+        : width(width), height(height), chunksX((width + CHUNK_SIZE - 1) / CHUNK_SIZE), chunksY((height + CHUNK_SIZE - 1) / CHUNK_SIZE),
+          cells(static_cast<size_t>(width) * height), chunks(static_cast<size_t>(chunksX) * chunksY) {}
+
+    // Gives every chunk its own stream of random numbers. The same seed always gives the same sequence of random numbers in each chunk.
+    void seed(const RandomService& random) {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            chunks[i].rng = random.chunkStream(static_cast<int>(i));
+        }
+    }
+
+    // Checks if the given position is within the bounds of the world.
+    bool inBounds(const int x, const int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height;
+    }
+
+    // Converts a position to an index into the cells array.
+    int index(const int x, const int y) const {
+        return y * width + x;
+    }
+
+    Cell& at(const int x, const int y) {
+        return cells[index(x, y)];
+    }
+
+    // Checks if the given position is within the bounds of the world and empty.
+    bool isEmpty(const int x, const int y) {
+        return inBounds(x, y) && at(x, y).id() == 0;
+    }
+
+    Chunk& chunkAt(const int x, const int y) {
+        return chunks[(y / CHUNK_SIZE) * chunksX + x / CHUNK_SIZE];
+    }
+
+    // Marks the given cell and its neighbors as changed, so that they get updated next frame.
+    // If the cell is on the border of a chunk, the neighboring chunks are woken up as well.
+    void markDirty(const int x, const int y) {
+        const int localX = x % CHUNK_SIZE;
+        const int localY = y % CHUNK_SIZE;
+
+        if (localX > 0 && localX < CHUNK_SIZE - 1 && localY > 0 && localY < CHUNK_SIZE - 1) {
+            chunkAt(x, y).nextDirty.include(x - 1, y - 1, x + 1, y + 1);
+            return;
+        }
+
+        for (int neighborY = y - 1; neighborY <= y + 1; neighborY++) {
+            for (int neighborX = x - 1; neighborX <= x + 1; neighborX++) {
+                if (inBounds(neighborX, neighborY)) {
+                    chunkAt(neighborX, neighborY).nextDirty.include(neighborX, neighborY, neighborX, neighborY);
+                }
+            }
+        }
+    }
+
+    // Sets the cell at the given position.
+    void set(const int x, const int y, const Cell& cell) {
+        at(x, y) = cell;
+        markDirty(x, y);
+    }
+
+    // Removes the particle at the given position.
+    void clear(const int x, const int y) {
+        at(x, y) = Cell{};
+        markDirty(x, y);
+    }
+
+    // Moves a particle from one position to another, leaving the old position empty.
+    void move(const int fromX, const int fromY, const int toX, const int toY) {
+        at(toX, toY) = at(fromX, fromY);
+        at(fromX, fromY) = Cell{};
+        markDirty(fromX, fromY);
+        markDirty(toX, toY);
+    }
+
+    // Counts a particle sliding down diagonally. Used to measure if the update order makes the particles drift in one direction.
+    void countDiagonalMove(const int x, const int y, const int direction) {
+        chunkAt(x, y).diagonalMoves[direction > 0].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Checks if the given cell has already been updated this frame.
+    bool updatedThisFrame(const Cell& cell) const {
+        return cell.stamp == stamp;
+    }
+
+    // Marks the given cell as updated this frame, so that it isn't updated again if it moves further along the update order.
+    void markUpdated(Cell& cell) const {
+        cell.stamp = stamp;
+    }
+
+    // Checks if nothing changed this frame, so that nothing will be updated next frame either.
+    bool settled() const {
+        for (const Chunk& chunk : chunks) {
+            if (!chunk.nextDirty.load().empty()) return false;
+        }
+        return true;
+    }
+
+    // Starts a new frame. The cells that changed last frame become the cells to update this frame.
+    // The frame stamp moves on instead of clearing a flag on every cell. Only when the stamps run out and start over,
+    // every cell is reset, so that stamps left over from long ago can't be mistaken for the new ones.
+    void beginFrame() {
+        if (stamp == STAMP_COUNT) {
+            for (Cell& cell : cells) cell.stamp = 0;
+            stamp = 0;
+        }
+        stamp++;
+
+        for (Chunk& chunk : chunks) {
+            chunk.dirty = chunk.nextDirty.load();
+            chunk.nextDirty.reset();
+            chunk.diagonalMoves[0].store(0, std::memory_order_relaxed);
+            chunk.diagonalMoves[1].store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif //WORLD_H
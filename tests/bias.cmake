@@ -0,0 +1,61 @@
+# Drops a block of sand onto a floor and fails if the particles slide down to one side more than the other, for every traversal order.
+# The block sits right on the border between two chunks, so that the order in which neighboring chunks are updated counts as well.
+# Called by ctest with -DHEADLESS=<path to fallingSandHeadless>.
+set(scene "${CMAKE_CURRENT_BINARY_DIR}/biasScene.txt")
+set(seeds 1 2 3 4 5)
+set(maxBias 100) # The largest average bias allowed over all the seeds, in units of 0.0001, as CMake only does integer math.
+
+# Builds the scene: 60 rows of 20 sand cells in the middle of a 256x200 world, and a row of stone at the bottom.
+set(sandRow "")
+set(stoneRow "")
+foreach(x RANGE 1 256)
+    if(x GREATER 118 AND x LESS_EQUAL 138)
+        string(APPEND sandRow "s")
+    else()
+        string(APPEND sandRow ".")
+    endif()
+    string(APPEND stoneRow "#")
+endforeach()
+set(lines "")
+foreach(y RANGE 0 198)
+    if(y LESS 60)
+        string(APPEND lines "${sandRow}\n")
+    else()
+        string(APPEND lines "\n")
+    endif()
+endforeach()
+file(WRITE "${scene}" "${lines}${stoneRow}\n")
+
+foreach(order shuffled rotating alternating random-rows)
+    set(total 0)
+    set(biases "")
+    foreach(seed ${seeds})
+        execute_process(
+            COMMAND ${HEADLESS} --world-width 256 --world-height 200 --scene ${scene} --ticks 1500 --seed ${seed} --order ${order}
+            OUTPUT_VARIABLE output
+            RESULT_VARIABLE result
+        )
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "The run with the ${order} order and seed ${seed} failed:\n${output}")
+        endif()
+
+        string(REGEX MATCH "bias: ([-+][0-9.]+)" match "${output}")
+        if(match STREQUAL "")
+            message(FATAL_ERROR "The run with the ${order} order and seed ${seed} didn't print a bias:\n${output}")
+        endif()
+        list(APPEND biases "${CMAKE_MATCH_1}")
+
+        # Adds the bias up in units of 0.0001, as it is printed with four decimals.
+        string(REGEX REPLACE "^\\+" "" bias "${CMAKE_MATCH_1}")
+        string(REGEX REPLACE "^(-?)0*([0-9]*)\\.([0-9]+)$" "\\1\\2\\3" units "${bias}")
+        string(REGEX REPLACE "^(-?)0+([0-9])" "\\1\\2" units "${units}")
+        math(EXPR total "${total} + ${units}")
+    endforeach()
+
+    list(LENGTH seeds count)
+    math(EXPR average "${total} / ${count}")
+    if(average GREATER maxBias OR average LESS -${maxBias})
+        message(FATAL_ERROR "The ${order} order is biased by ${average} in units of 0.0001 on average, more than ${maxBias}. The biases were ${biases}.")
+    endif()
+    message(STATUS "${order}: average bias ${average} in units of 0.0001, from ${biases}")
+endforeach()
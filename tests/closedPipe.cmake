@@ -0,0 +1,15 @@
+# Exports into a pipe that is closed after its first few bytes, like a player that quits early, and fails unless the
+# headless simulation reports the failed export and exits on its own. Called by ctest with -DHEADLESS=<path to fallingSandHeadless>.
+execute_process(
+    COMMAND ${HEADLESS} --world-width 256 --world-height 256 --ticks 200 --seed 42 --export /dev/stdout
+    COMMAND head -c 100
+    OUTPUT_QUIET
+    ERROR_VARIABLE errors
+    RESULTS_VARIABLE results
+)
+
+list(GET results 0 result)
+if(NOT result STREQUAL "1")
+    message(FATAL_ERROR "Exporting into a closed pipe ended with '${result}' instead of a failed export:\n${errors}")
+endif()
+message(STATUS "Exporting into a closed pipe failed cleanly: ${errors}")
@@ -0,0 +1,28 @@
+# Runs the headless simulation with the same seed on different numbers of threads, with both random modes,
+# and fails if any of the runs ends up with a different world. Called by ctest with -DHEADLESS=<path to fallingSandHeadless>.
+foreach(random streams counter)
+    set(expected "")
+    foreach(threads 1 2 3 4)
+        execute_process(
+            COMMAND ${HEADLESS} --world-width 480 --world-height 270 --ticks 300 --seed 42 --random ${random} --threads ${threads}
+            OUTPUT_VARIABLE output
+            RESULT_VARIABLE result
+        )
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "The run with ${threads} threads and ${random} random numbers failed:\n${output}")
+        endif()
+
+        string(REGEX MATCH "world hash: ([0-9a-f]+)" match "${output}")
+        set(hash "${CMAKE_MATCH_1}")
+        if(hash STREQUAL "")
+            message(FATAL_ERROR "The run with ${threads} threads and ${random} random numbers didn't print a world hash:\n${output}")
+        endif()
+
+        if(expected STREQUAL "")
+            set(expected "${hash}")
+        elseif(NOT hash STREQUAL expected)
+            message(FATAL_ERROR "With ${random} random numbers, ${threads} threads ended up with world ${hash} instead of ${expected}.")
+        endif()
+    endforeach()
+    message(STATUS "${random}: every thread count ended up with world ${expected}")
+endforeach()
@@ -0,0 +1,48 @@
+#include <chrono> // Includes the chrono library for the timeouts.
+#include <cstdio> // Includes the cstdio library for printing the result.
+#include <cstdlib> // Includes the cstdlib library for the exit codes.
+#include <thread> // Includes the thread library for sleeping between checks.
+#include "../src/simulationThread.h" // Includes the simulationThread.h header file.
+
+// Checks that the simulation thread goes idle once a large world has settled, and stays idle, publishing no more images.
+// A 4096x4096 world takes many ticks to reduce into the overview, so this fails if the thread waits for the overview
+// or keeps changing the palette instead of going to sleep.
+int main() {
+    constexpr int SIZE = 4096;
+    constexpr auto TIMEOUT = std::chrono::seconds(60);
+
+    // A floor of stone with a heap of sand on top of it, which settles after a few hundred ticks.
+    World world(SIZE, SIZE);
+    Random random(1);
+    for (int y = SIZE - 256; y < SIZE; y++) {
+        for (int x = 0; x < SIZE; x++) world.set(x, y, ParticleRegistry::create(ParticleType::Stone, random));
+    }
+    for (int y = SIZE - 320; y < SIZE - 256; y++) {
+        for (int x = 1024; x < 1088; x++) world.set(x, y, ParticleRegistry::create(ParticleType::Sand, random));
+    }
+
+    Simulation simulation(world, 0, 1);
+    SimulationThread thread(world, simulation, DirtyRect{0, 0, 1919, 1079}, 1920, 1080, false, nullptr);
+
+    // Waits for the thread to go idle, taking the images it publishes like the main thread would.
+    const auto start = std::chrono::steady_clock::now();
+    while (!thread.idle()) {
+        thread.acquire();
+        if (std::chrono::steady_clock::now() - start > TIMEOUT) {
+            printf("The simulation thread didn't go idle within %lld seconds.\n", static_cast<long long>(TIMEOUT.count()));
+            return EXIT_FAILURE;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    thread.acquire(); // Takes the image published right before it went idle.
+    printf("idle after %.1f s\n", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    // Once idle, nothing is published until something wakes it up.
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    if (!thread.idle() || thread.acquire()) {
+        printf("The simulation thread woke up by itself.\n");
+        return EXIT_FAILURE;
+    }
+    printf("stayed idle\n");
+    return EXIT_SUCCESS;
+}